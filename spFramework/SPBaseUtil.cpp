@@ -22,3 +22,10 @@ string SP::getTimeString() {
 
 	return ss.str();
 }
+
+bool SP::bigEndianMachine() {
+	long l = 0;
+	char *b = (char *)&l;
+	b[3] = 1;
+	return l == 1;
+}
@@ -18,6 +18,7 @@ using namespace std;
 namespace SP {
 
 string getTimeString();
+bool bigEndianMachine();
 
 template<typename T> string cat(T s) {
 	stringstream ss;
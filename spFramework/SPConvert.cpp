@@ -0,0 +1,519 @@
+//============================================================================
+// Name        : SPConvert.cpp
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#include <su.h>
+#include <segy.h>
+#include <header.h>
+#include <hdr.h>
+#include <string.h>
+#include "SPConvert.hh"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SP_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace SP;
+
+namespace {
+
+enum Kernel {
+	SCALAR, SSE2, AVX2, AVX512
+};
+
+Kernel selectKernel() {
+#ifdef SP_X86_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+		return AVX512;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		return AVX2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return SSE2;
+	}
+#endif
+	return SCALAR;
+}
+
+Kernel getKernel() {
+	static Kernel kernel = selectKernel();
+	return kernel;
+}
+
+bool hasShuffle() {
+#ifdef SP_X86_KERNELS
+	static bool ssse3 = __builtin_cpu_supports("ssse3");
+	return ssse3;
+#else
+	return false;
+#endif
+}
+
+/**
+ * The byte permutation swapping all header fields: byte i of the swapped
+ * header is byte from[i] of the original. Fields never cross a 16 byte
+ * boundary in the SU header, so the permutation works as an in-lane byte
+ * shuffle; this is checked when the table is built.
+ */
+struct SwapLayout {
+	unsigned char from[HDRBYTES];
+	bool inLane;
+
+	SwapLayout() {
+		for (int i = 0; i < HDRBYTES; ++i) {
+			from[i] = i;
+		}
+		for (int k = 0; k < SU_NKEYS; ++k) {
+			int size;
+			switch (hdr[k].type[0]) {
+			case 'h':
+			case 'u':
+				size = 2;
+				break;
+			case 'd':
+				size = 8;
+				break;
+			default:
+				size = 4;
+			}
+			for (int j = 0; j < size; ++j) {
+				from[hdr[k].offs + j] = hdr[k].offs + size - 1 - j;
+			}
+		}
+		inLane = true;
+		for (int i = 0; i < HDRBYTES; ++i) {
+			inLane = inLane && from[i] / 16 == i / 16;
+		}
+	}
+
+	static SwapLayout& get() {
+		static SwapLayout layout;
+		return layout;
+	}
+};
+
+#ifdef SP_X86_KERNELS
+
+/*
+ * The vector kernels avoid the normalization loop of the reference: the
+ * 24 bit mantissa converted to float is exact, so the float has the
+ * normalized mantissa bits already and its exponent tells how far the
+ * mantissa had to be shifted. With e the IBM exponent and f the exponent of
+ * the converted mantissa, the IEEE exponent is 4 * e + f - 280.
+ */
+
+__attribute__((target("sse2")))
+int ibmToFloatSSE2(const int* from, int* to, int n, int endian) {
+	const __m128i signMask = _mm_set1_epi32(0x80000000);
+	const __m128i mantMask = _mm_set1_epi32(0x00ffffff);
+	const __m128i expMask = _mm_set1_epi32(0x7f000000);
+	const __m128i fracMask = _mm_set1_epi32(0x007fffff);
+	const __m128i largest = _mm_set1_epi32(0x7f7fffff);
+	const __m128i bias = _mm_set1_epi32(280);
+	const __m128i maxExp = _mm_set1_epi32(254);
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i byte1 = _mm_set1_epi32(0x00ff0000);
+	const __m128i byte2 = _mm_set1_epi32(0x0000ff00);
+	int bad = 0;
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(from + i));
+		if (endian == 0) {
+			x = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(x, 24),
+					_mm_srli_epi32(x, 24)), _mm_or_si128(_mm_and_si128(
+					_mm_slli_epi32(x, 8), byte1), _mm_and_si128(
+					_mm_srli_epi32(x, 8), byte2)));
+		}
+		__m128i mant = _mm_and_si128(x, mantMask);
+		__m128i f = _mm_castps_si128(_mm_cvtepi32_ps(mant));
+		__m128i t = _mm_sub_epi32(_mm_add_epi32(_mm_srli_epi32(_mm_and_si128(
+				x, expMask), 22), _mm_srli_epi32(f, 23)), bias);
+		__m128i sign = _mm_and_si128(x, signMask);
+		__m128i res = _mm_or_si128(_mm_or_si128(sign, _mm_slli_epi32(t, 23)),
+				_mm_and_si128(f, fracMask));
+		__m128i over = _mm_cmpgt_epi32(t, maxExp);
+		res = _mm_or_si128(_mm_andnot_si128(over, res), _mm_and_si128(over,
+				_mm_or_si128(sign, largest)));
+		__m128i noMant = _mm_cmpeq_epi32(mant, zero);
+		__m128i gone = _mm_or_si128(_mm_cmplt_epi32(t, one), noMant);
+		res = _mm_andnot_si128(gone, res);
+		_mm_storeu_si128((__m128i*)(to + i), res);
+		bad += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(
+				_mm_andnot_si128(_mm_cmpeq_epi32(x, zero), noMant))));
+	}
+	return bad + SPConvert::ibmToFloatScalar(from + i, to + i, n - i, endian);
+}
+
+__attribute__((target("avx2")))
+int ibmToFloatAVX2(const int* from, int* to, int n, int endian) {
+	const __m256i signMask = _mm256_set1_epi32(0x80000000);
+	const __m256i mantMask = _mm256_set1_epi32(0x00ffffff);
+	const __m256i expMask = _mm256_set1_epi32(0x7f000000);
+	const __m256i fracMask = _mm256_set1_epi32(0x007fffff);
+	const __m256i largest = _mm256_set1_epi32(0x7f7fffff);
+	const __m256i bias = _mm256_set1_epi32(280);
+	const __m256i maxExp = _mm256_set1_epi32(254);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9,
+			8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14,
+			13, 12);
+	int bad = 0;
+	int i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)(from + i));
+		if (endian == 0) {
+			x = _mm256_shuffle_epi8(x, swap);
+		}
+		__m256i mant = _mm256_and_si256(x, mantMask);
+		__m256i f = _mm256_castps_si256(_mm256_cvtepi32_ps(mant));
+		__m256i t = _mm256_sub_epi32(_mm256_add_epi32(_mm256_srli_epi32(
+				_mm256_and_si256(x, expMask), 22), _mm256_srli_epi32(f, 23)),
+				bias);
+		__m256i sign = _mm256_and_si256(x, signMask);
+		__m256i res = _mm256_or_si256(_mm256_or_si256(sign,
+				_mm256_slli_epi32(t, 23)), _mm256_and_si256(f, fracMask));
+		res = _mm256_blendv_epi8(res, _mm256_or_si256(sign, largest),
+				_mm256_cmpgt_epi32(t, maxExp));
+		__m256i noMant = _mm256_cmpeq_epi32(mant, zero);
+		__m256i gone = _mm256_or_si256(_mm256_cmpgt_epi32(one, t), noMant);
+		res = _mm256_andnot_si256(gone, res);
+		_mm256_storeu_si256((__m256i*)(to + i), res);
+		bad += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(
+				_mm256_andnot_si256(_mm256_cmpeq_epi32(x, zero), noMant))));
+	}
+	return bad + SPConvert::ibmToFloatScalar(from + i, to + i, n - i, endian);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+int ibmToFloatAVX512(const int* from, int* to, int n, int endian) {
+	const __m512i signMask = _mm512_set1_epi32(0x80000000);
+	const __m512i mantMask = _mm512_set1_epi32(0x00ffffff);
+	const __m512i expMask = _mm512_set1_epi32(0x7f000000);
+	const __m512i fracMask = _mm512_set1_epi32(0x007fffff);
+	const __m512i largest = _mm512_set1_epi32(0x7f7fffff);
+	const __m512i bias = _mm512_set1_epi32(280);
+	const __m512i maxExp = _mm512_set1_epi32(254);
+	const __m512i one = _mm512_set1_epi32(1);
+	const __m512i zero = _mm512_setzero_si512();
+	const __m512i swap = _mm512_set4_epi32(0x0c0d0e0f, 0x08090a0b,
+			0x04050607, 0x00010203);
+	int bad = 0;
+	int i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m512i x = _mm512_loadu_si512((const void*)(from + i));
+		if (endian == 0) {
+			x = _mm512_shuffle_epi8(x, swap);
+		}
+		__m512i mant = _mm512_and_si512(x, mantMask);
+		__m512i f = _mm512_castps_si512(_mm512_cvtepi32_ps(mant));
+		__m512i t = _mm512_sub_epi32(_mm512_add_epi32(_mm512_srli_epi32(
+				_mm512_and_si512(x, expMask), 22), _mm512_srli_epi32(f, 23)),
+				bias);
+		__m512i sign = _mm512_and_si512(x, signMask);
+		__m512i res = _mm512_or_si512(_mm512_or_si512(sign,
+				_mm512_slli_epi32(t, 23)), _mm512_and_si512(f, fracMask));
+		res = _mm512_mask_blend_epi32(_mm512_cmpgt_epi32_mask(t, maxExp), res,
+				_mm512_or_si512(sign, largest));
+		__mmask16 noMant = _mm512_cmpeq_epi32_mask(mant, zero);
+		__mmask16 keep = ~(_mm512_cmplt_epi32_mask(t, one) | noMant);
+		_mm512_storeu_si512((void*)(to + i), _mm512_maskz_mov_epi32(keep, res));
+		bad += __builtin_popcount(noMant & _mm512_cmpneq_epi32_mask(x, zero));
+	}
+	return bad + SPConvert::ibmToFloatScalar(from + i, to + i, n - i, endian);
+}
+
+__attribute__((target("ssse3")))
+void swapHeaderSSSE3(void* header, const SwapLayout& layout) {
+	char* h = (char*)header;
+	for (int i = 0; i < HDRBYTES; i += 16) {
+		__m128i mask = _mm_loadu_si128((const __m128i*)(layout.from + i));
+		mask = _mm_sub_epi8(mask, _mm_set1_epi8(i));
+		__m128i x = _mm_loadu_si128((const __m128i*)(h + i));
+		_mm_storeu_si128((__m128i*)(h + i), _mm_shuffle_epi8(x, mask));
+	}
+}
+
+__attribute__((target("avx2")))
+void swapHeaderAVX2(void* header, const SwapLayout& layout) {
+	char* h = (char*)header;
+	int i = 0;
+	for (; i + 32 <= HDRBYTES; i += 32) {
+		__m256i mask = _mm256_loadu_si256((const __m256i*)(layout.from + i));
+		mask = _mm256_sub_epi8(mask, _mm256_setr_epi8(i, i, i, i, i, i, i, i,
+				i, i, i, i, i, i, i, i, i + 16, i + 16, i + 16, i + 16,
+				i + 16, i + 16, i + 16, i + 16, i + 16, i + 16, i + 16,
+				i + 16, i + 16, i + 16, i + 16, i + 16));
+		__m256i x = _mm256_loadu_si256((const __m256i*)(h + i));
+		_mm256_storeu_si256((__m256i*)(h + i), _mm256_shuffle_epi8(x, mask));
+	}
+	for (; i < HDRBYTES; i += 16) {
+		__m128i mask = _mm_loadu_si128((const __m128i*)(layout.from + i));
+		mask = _mm_sub_epi8(mask, _mm_set1_epi8(i));
+		__m128i x = _mm_loadu_si128((const __m128i*)(h + i));
+		_mm_storeu_si128((__m128i*)(h + i), _mm_shuffle_epi8(x, mask));
+	}
+}
+
+__attribute__((target("sse2")))
+void swapFloatsSSE2(void* data, int n) {
+	int* d = (int*)data;
+	const __m128i byte1 = _mm_set1_epi32(0x00ff0000);
+	const __m128i byte2 = _mm_set1_epi32(0x0000ff00);
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(d + i));
+		x = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(x, 24),
+				_mm_srli_epi32(x, 24)), _mm_or_si128(_mm_and_si128(
+				_mm_slli_epi32(x, 8), byte1), _mm_and_si128(
+				_mm_srli_epi32(x, 8), byte2)));
+		_mm_storeu_si128((__m128i*)(d + i), x);
+	}
+	SPConvert::swapFloatsScalar(d + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void swapFloatsAVX2(void* data, int n) {
+	int* d = (int*)data;
+	const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9,
+			8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14,
+			13, 12);
+	int i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)(d + i));
+		_mm256_storeu_si256((__m256i*)(d + i), _mm256_shuffle_epi8(x, swap));
+	}
+	SPConvert::swapFloatsScalar(d + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void swapFloatsAVX512(void* data, int n) {
+	int* d = (int*)data;
+	const __m512i swap = _mm512_set4_epi32(0x0c0d0e0f, 0x08090a0b,
+			0x04050607, 0x00010203);
+	int i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m512i x = _mm512_loadu_si512((const void*)(d + i));
+		_mm512_storeu_si512((void*)(d + i), _mm512_shuffle_epi8(x, swap));
+	}
+	SPConvert::swapFloatsScalar(d + i, n - i);
+}
+
+__attribute__((target("sse2")))
+void decimateSSE2(const float* from, float* to, int n, int step) {
+	// the even samples of two vectors
+	int i = 0;
+	if (step == 2) {
+		for (; i + 4 <= n; i += 4) {
+			__m128 a = _mm_loadu_ps(from + 2 * i);
+			__m128 b = _mm_loadu_ps(from + 2 * i + 4);
+			_mm_storeu_ps(to + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+		}
+	}
+	SPConvert::decimateScalar(from + i * step, to + i, n - i, step);
+}
+
+__attribute__((target("avx2")))
+void decimateAVX2(const float* from, float* to, int n, int step) {
+	const __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4,
+			5, 6, 7), _mm256_set1_epi32(step));
+	int i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 x = _mm256_i32gather_ps(from + ((long)i) * step, index, 4);
+		_mm256_storeu_ps(to + i, x);
+	}
+	SPConvert::decimateScalar(from + ((long)i) * step, to + i, n - i, step);
+}
+
+__attribute__((target("avx512f")))
+void decimateAVX512(const float* from, float* to, int n, int step) {
+	const __m512i index = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4,
+			5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(step));
+	int i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m512 x = _mm512_i32gather_ps(index, from + ((long)i) * step, 4);
+		_mm512_storeu_ps(to + i, x);
+	}
+	SPConvert::decimateScalar(from + ((long)i) * step, to + i, n - i, step);
+}
+
+#endif
+}
+
+void SPConvert::swapHeader(void* header) {
+	SwapLayout& layout = SwapLayout::get();
+#ifdef SP_X86_KERNELS
+	if (layout.inLane) {
+		if (getKernel() >= AVX2) {
+			swapHeaderAVX2(header, layout);
+			return;
+		}
+		if (hasShuffle()) {
+			swapHeaderSSSE3(header, layout);
+			return;
+		}
+	}
+#endif
+	swapHeaderScalar(header);
+}
+
+void SPConvert::swapHeaderScalar(void* header) {
+	SwapLayout& layout = SwapLayout::get();
+	unsigned char* h = (unsigned char*)header;
+	unsigned char copy[HDRBYTES];
+	for (int i = 0; i < HDRBYTES; ++i) {
+		copy[i] = h[i];
+	}
+	for (int i = 0; i < HDRBYTES; ++i) {
+		h[i] = copy[layout.from[i]];
+	}
+}
+
+void SPConvert::swapFloats(void* data, int n) {
+	switch (getKernel()) {
+#ifdef SP_X86_KERNELS
+	case AVX512:
+		swapFloatsAVX512(data, n);
+		return;
+	case AVX2:
+		swapFloatsAVX2(data, n);
+		return;
+	case SSE2:
+		swapFloatsSSE2(data, n);
+		return;
+#endif
+	default:
+		swapFloatsScalar(data, n);
+	}
+}
+
+void SPConvert::swapFloatsScalar(void* data, int n) {
+	unsigned int* d = (unsigned int*)data;
+	for (int i = 0; i < n; ++i) {
+		unsigned int x = d[i];
+		d[i] = (x << 24) | ((x & 0xff00) << 8) | ((x >> 8) & 0xff00) | (x >> 24);
+	}
+}
+
+int SPConvert::ibmToFloat(const int* from, int* to, int n, int endian) {
+	switch (getKernel()) {
+#ifdef SP_X86_KERNELS
+	case AVX512:
+		return ibmToFloatAVX512(from, to, n, endian);
+	case AVX2:
+		return ibmToFloatAVX2(from, to, n, endian);
+	case SSE2:
+		return ibmToFloatSSE2(from, to, n, endian);
+#endif
+	default:
+		return ibmToFloatScalar(from, to, n, endian);
+	}
+}
+
+int SPConvert::ibmToFloatScalar(const int* from, int* to, int n, int endian)
+/***********************************************************************
+ibm_to_float - convert between 32 bit IBM and IEEE floating numbers
+ ************************************************************************
+Input::
+from		input vector
+to		output vector, can be same as input vector
+endian		byte order =0 little endian (DEC, PC's)
+                            =1 other systems
+ *************************************************************************
+Notes:
+Up to 3 bits lost on IEEE -> IBM
+
+Assumes sizeof(int) == 4
+
+IBM -> IEEE may overflow or underflow, taken care of by
+substituting large number or zero
+
+Only integer shifting and masking are used.
+ *************************************************************************
+Credits: CWP: Brian Sumner,  c.1985
+ *************************************************************************/
+{
+    int fconv, fmant, i, t;
+    int bad = 0;
+
+    for (i = 0; i < n; ++i) {
+
+        fconv = from[i];
+
+        /* if little endian, i.e. endian=0 do this */
+        if (endian == 0) fconv = (fconv << 24) | ((fconv >> 24) & 0xff) |
+            ((fconv & 0xff00) << 8) | ((fconv & 0xff0000) >> 8);
+
+        if (fconv) {
+            fmant = 0x00ffffff & fconv;
+            /* The next lines were added by Toralf Foerster */
+            /* to trap non-IBM format data i.e. conv=0 data  */
+            /* a zero mantissa would never normalize, so it underflows */
+            if (fmant == 0) {
+                ++bad;
+                to[i] = 0;
+                continue;
+            }
+            t = (int) ((0x7f000000 & fconv) >> 22) - 130;
+            while (!(fmant & 0x00800000)) {
+                --t;
+                fmant <<= 1;
+            }
+            if (t > 254) fconv = (0x80000000 & fconv) | 0x7f7fffff;
+            else if (t <= 0) fconv = 0;
+            else fconv = (0x80000000 & fconv) | (t << 23)
+                | (0x007fffff & fmant);
+        }
+        to[i] = fconv;
+    }
+    return bad;
+}
+
+void SPConvert::decimate(const float* from, float* to, int n, int step) {
+	if (step == 1) {
+		memmove(to, from, n * sizeof(float));
+		return;
+	}
+	switch (getKernel()) {
+#ifdef SP_X86_KERNELS
+	case AVX512:
+		decimateAVX512(from, to, n, step);
+		return;
+	case AVX2:
+		decimateAVX2(from, to, n, step);
+		return;
+	case SSE2:
+		decimateSSE2(from, to, n, step);
+		return;
+#endif
+	default:
+		decimateScalar(from, to, n, step);
+	}
+}
+
+void SPConvert::decimateScalar(const float* from, float* to, int n,
+		int step) {
+	for (int i = 0; i < n; ++i) {
+		to[i] = from[((long)i) * step];
+	}
+}
+
+string SPConvert::getKernelName() {
+	switch (getKernel()) {
+	case AVX512:
+		return "AVX-512";
+	case AVX2:
+		return "AVX2";
+	case SSE2:
+		return "SSE2";
+	default:
+		return "scalar";
+	}
+}
@@ -0,0 +1,77 @@
+//============================================================================
+// Name        : SPConvert.hh
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+
+#ifndef SPCONVERT_H_
+#define SPCONVERT_H_
+
+#include <string>
+
+using namespace std;
+
+namespace SP {
+
+/**
+ * Number format conversions for trace data. Each conversion has a plain C++
+ * reference implementation and vectorized kernels (SSE2, AVX2, AVX-512) of
+ * which the best one supported by the CPU is chosen at the first call. The
+ * kernels give bit identical results to the reference.
+ */
+class SPConvert {
+public:
+	/**
+	 * Convert n 32 bit IBM floating point numbers to IEEE. With endian=0 the
+	 * input is big endian and swapped on the way (little endian machines),
+	 * with endian=1 it is taken as is. from and to can be the same vector.
+	 * Overflows are clamped to the largest float with the sign kept,
+	 * underflows become zero. Returns the number of non-zero input values
+	 * with a zero mantissa, which are not IBM numbers and converted to zero.
+	 */
+	static int ibmToFloat(const int* from, int* to, int n, int endian);
+
+	/**
+	 * The reference implementation of ::ibmToFloat.
+	 */
+	static int ibmToFloatScalar(const int* from, int* to, int n, int endian);
+
+	/**
+	 * Swap the byte order of all fields of a 240 byte SU trace header in
+	 * place. The byte shuffle is built once from the SU header key table, so
+	 * the whole header is swapped with a few vector shuffles instead of a
+	 * swaphval() call per key.
+	 */
+	static void swapHeader(void* header);
+
+	/**
+	 * Swap the byte order of n 4 byte values (samples) in place.
+	 */
+	static void swapFloats(void* data, int n);
+
+	/**
+	 * The reference implementations of ::swapHeader and ::swapFloats.
+	 */
+	static void swapHeaderScalar(void* header);
+	static void swapFloatsScalar(void* data, int n);
+
+	/**
+	 * Take every step-th of the samples: to[i] = from[i * step] for i < n.
+	 * to may be the same vector as from, or before it.
+	 */
+	static void decimate(const float* from, float* to, int n, int step);
+
+	/**
+	 * The reference implementation of ::decimate.
+	 */
+	static void decimateScalar(const float* from, float* to, int n, int step);
+
+	/**
+	 * Name of the instruction set used by the conversions, for logging
+	 */
+	static string getKernelName();
+};
+}
+
+#endif /*SPCONVERT_H_*/
@@ -59,6 +59,7 @@ int SPProcessor::localMain(int argc, char **argv) {
 	try {
 		input = stdin;
 		output = stdout;
+		writer = 0;
 		stopProcessing = false;
 
         /* Initialize */
@@ -66,6 +67,7 @@ int SPProcessor::localMain(int argc, char **argv) {
         requestdoc(1) ;
 
 		initParam(argc, argv);
+		outBuffer = getIntParameter("outbuffer", 1024) * 1024L;
 		SPSegy::initAccessor();
 
 		init();
@@ -74,16 +76,55 @@ int SPProcessor::localMain(int argc, char **argv) {
 		}
 
 		cleanup();
+		flushOutput();
 		return 0;
 	} catch (SPException e) {
+		flushPending();
 		cerr << e.what() << endl;
 		return 1;
 	} catch(...) {
+		flushPending();
 		cerr << "Unexpected exception from application" << endl;
 	}
 	return 2;
 }
 
+/**
+ * Write out the traces produced before an error. A failing write is
+ * ignored, the error being reported is the original one.
+ */
+void SPProcessor::flushPending() {
+	try {
+		flushOutput();
+	} catch (...) {
+	}
+}
+
+void SPProcessor::writeTrace(segy* trace) {
+	if (output == 0) {
+		return;
+	}
+	if (writer == 0) {
+		if (outBuffer <= 0) {
+			fputtr(output, trace);
+			return;
+		}
+		fflush(output);
+		writer = new SPTraceWriter(fileno(output), outBuffer);
+		writer->setSplice(getBooleanParameter("vmsplice", false));
+	}
+	writer->put(trace);
+}
+
+void SPProcessor::flushOutput() {
+	if (writer != 0) {
+		writer->flush();
+	}
+	if (output != 0) {
+		fflush(output);
+	}
+}
+
 void SPProcessor::initParam(int argc, char **argv) {
 	command = argv[0];
 	for (int i = 1; i < argc; ++i) {
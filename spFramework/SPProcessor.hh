@@ -10,6 +10,7 @@
 
 #include "SPAccessors.hh"
 #include "SPBaseUtil.hh"
+#include "SPTraceWriter.hh"
 #include <vector>
 #include <map>
 #include <string>
@@ -168,11 +169,23 @@ public:
 	 * the SPSegy after processing.
 	 */
 	virtual void dispatch(SPSegy* data) {
-		if (output != 0) {
-			fputtr(output, data->getTrace());
-		}
+		writeTrace(data->getTrace());
 	}
 
+	/**
+	 * Write a trace to the output without taking ownership of it. The output
+	 * goes through a SPTraceWriter collecting the traces into large blocks,
+	 * unless the command line parameter outbuffer=0 asks for plain fputtr().
+	 * outbuffer=<KB> sets the size of each of the output buffers and
+	 * vmsplice=1 splices the buffers into the output if it is a pipe.
+	 */
+	void writeTrace(segy* trace);
+
+	/**
+	 * Write out the traces still held in the output buffers.
+	 */
+	void flushOutput();
+
 	/**
 	 * Delete the object and signal to SPProcessor that this trace is disposed
 	 * of already. It is important to call this method for discarding the trace
@@ -205,6 +218,9 @@ public:
 	 * output traces will be discarded.
 	 */
 	void setoutput(FILE* f) {
+		flushOutput();
+		delete writer;
+		writer = 0;
 		output = f;
 	}
 
@@ -292,6 +308,9 @@ public:
 	virtual void cleanup() {
 	}
 
+private:
+	void flushPending();
+
 private:
 
 	/** the tempporary buffer to hold data read from the input */
@@ -302,6 +321,11 @@ private:
 	/** the output channel for traces, usually stdout */
 	FILE* output;
 
+	/** block writer on output, created with the first trace */
+	SPTraceWriter* writer;
+	/** bytes of each output buffer of writer, 0 for plain fputtr() */
+	long outBuffer;
+
 	/** name of the command calling this module */
 	string command;
 
@@ -0,0 +1,171 @@
+//============================================================================
+// Name        : SPTraceWriter.cpp
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <header.h>
+#include "SPTraceWriter.hh"
+#include "SPBaseUtil.hh"
+
+using namespace std;
+using namespace SP;
+
+SPTraceWriter::SPTraceWriter(int fd, long size, int number) :
+	fd(fd), size(size), pipe(false), splice(false), buffers(number, (char*)0),
+			io(number), current(0), used(0), written(0) {
+	long page = sysconf(_SC_PAGESIZE);
+	this->size = (size + page - 1) / page * page;
+
+	struct stat s;
+	if (fstat(fd, &s) == 0 && S_ISFIFO(s.st_mode)) {
+		pipe = true;
+#ifdef F_SETPIPE_SZ
+		// as large as the system allows, up to one batch of buffers
+		for (long p = this->size * number; p >= page; p /= 2) {
+			if (fcntl(fd, F_SETPIPE_SZ, p) >= 0) {
+				SPVerbose::show(SPVerbose::DATA, "Output pipe size set to ",
+						fcntl(fd, F_GETPIPE_SZ));
+				break;
+			}
+		}
+#endif
+	}
+	allocate();
+	SPVerbose::show(SPVerbose::DATA, "Output buffers: ", number, " x ",
+			this->size, " bytes");
+}
+
+SPTraceWriter::~SPTraceWriter() {
+	flush();
+	release();
+}
+
+/**
+ * Hand the buffers to the output pipe with vmsplice() instead of writing
+ * them. Returns whether splicing is used, which is only possible on a pipe.
+ */
+bool SPTraceWriter::setSplice(bool on) {
+#ifdef SPLICE_F_GIFT
+	if (on && pipe) {
+		flush();
+		release();
+		splice = true;
+		allocate();
+		SPVerbose::show(SPVerbose::DATA, "Output buffers spliced into pipe");
+		return true;
+	}
+#endif
+	return splice = false;
+}
+
+void SPTraceWriter::allocate() {
+	for (unsigned int i = 0; i < buffers.size(); ++i) {
+		void* b;
+		if (splice) {
+			b = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE
+					| MAP_ANONYMOUS, -1, 0);
+			if (b == MAP_FAILED) {
+				throw SPException("Output buffer mapping failed: ", errno);
+			}
+		} else if (posix_memalign(&b, sysconf(_SC_PAGESIZE), size) != 0) {
+			throw SPException("Output buffer allocation failed");
+		}
+		buffers[i] = (char*)b;
+	}
+}
+
+void SPTraceWriter::release() {
+	for (unsigned int i = 0; i < buffers.size(); ++i) {
+		if (buffers[i] == 0) {
+			continue;
+		}
+		if (splice) {
+			munmap(buffers[i], size);
+		} else {
+			free(buffers[i]);
+		}
+		buffers[i] = 0;
+	}
+}
+
+void SPTraceWriter::put(segy* trace) {
+	append((const char*)trace, HDRBYTES + trace->ns * sizeof(float));
+}
+
+void SPTraceWriter::append(const char* data, long length) {
+	while (length > 0) {
+		if (used == size) {
+			++current;
+			used = 0;
+			if (current == (int)buffers.size()) {
+				flush();
+			}
+		}
+		long l = size - used < length ? size - used : length;
+		memcpy(buffers[current] + used, data, l);
+		used += l;
+		data += l;
+		length -= l;
+	}
+}
+
+/**
+ * Write all filled buffers.
+ */
+void SPTraceWriter::flush() {
+	int n = used > 0 ? current + 1 : current;
+	if (n == 0) {
+		return;
+	}
+	for (int i = 0; i < n; ++i) {
+		io[i].iov_base = buffers[i];
+		io[i].iov_len = i < current ? size : used;
+	}
+	writeAll(&io[0], n);
+	if (splice) {
+		// the pipe still refers to the pages
+		release();
+		allocate();
+	}
+	current = 0;
+	used = 0;
+}
+
+void SPTraceWriter::writeAll(struct iovec* io, int n) {
+	while (n > 0) {
+		ssize_t done;
+#ifdef SPLICE_F_GIFT
+		if (splice) {
+			done = vmsplice(fd, io, n, 0);
+		} else
+#endif
+		done = writev(fd, io, n);
+		if (done < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw SPException("Writing traces to output failed: ", errno);
+		}
+		written += done;
+		while (n > 0 && (size_t)done >= io->iov_len) {
+			done -= io->iov_len;
+			++io;
+			--n;
+		}
+		if (n > 0) {
+			io->iov_base = (char*)io->iov_base + done;
+			io->iov_len -= done;
+		}
+	}
+}
@@ -0,0 +1,78 @@
+//============================================================================
+// Name        : SPTraceWriter.hh
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+
+#ifndef SPTRACEWRITER_H_
+#define SPTRACEWRITER_H_
+
+#include <vector>
+#include <sys/uio.h>
+#include <su.h>
+#include <segy.h>
+
+using namespace std;
+
+namespace SP {
+
+/**
+ * Writes a stream of SU traces to a file descriptor in large blocks. The
+ * traces are gathered into a few page aligned buffers, which are written
+ * together with one writev() when all of them are full. The byte stream is
+ * the same as written by fputtr().
+ *
+ * If the descriptor is a pipe, its capacity is raised so the reader at the
+ * other end finds a full pipe more often. With splicing switched on, the
+ * buffers are handed to the pipe with vmsplice() instead of being copied
+ * into it; fresh buffers are mapped for each batch then, because the pipe
+ * keeps referring to the pages of the old ones until they are read.
+ */
+class SPTraceWriter {
+public:
+	/**
+	 * Writer with number buffers of size bytes each on descriptor fd.
+	 */
+	SPTraceWriter(int fd, long size, int number = 4);
+
+	/**
+	 * Flushes the remaining traces.
+	 */
+	~SPTraceWriter();
+
+	void put(segy* trace);
+	void flush();
+	bool setSplice(bool on);
+
+	int getDescriptor() {
+		return fd;
+	}
+
+	long long getBytesWritten() {
+		return written;
+	}
+
+private:
+	void allocate();
+	void release();
+	void append(const char* data, long length);
+	void writeAll(struct iovec* io, int n);
+
+private:
+	int fd;
+	long size;
+	bool pipe;
+	bool splice;
+	vector<char*> buffers;
+	/** the write list of ::flush, one entry per buffer */
+	vector<struct iovec> io;
+	/** the buffer being filled */
+	int current;
+	/** bytes used in the current buffer */
+	long used;
+	long long written;
+};
+}
+
+#endif /*SPTRACEWRITER_H_*/
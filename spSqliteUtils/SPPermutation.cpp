@@ -0,0 +1,171 @@
+//============================================================================
+// Name        : SPPermutation.cpp
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#include "SPPermutation.hh"
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace SP;
+
+static const char magic[8] = { 'S', 'P', 'P', 'E', 'R', 'M', '1', 0 };
+
+/**
+ * The sidecar file of the database for the order, e.g. data.db.cdp+offset+.perm
+ * for the order cdp ascending, offset ascending, indexnumber ascending.
+ */
+string SPPermutation::getFileName(const string& dbPath,
+		vector<SPSortKey>& order) {
+	string res = dbPath + ".";
+	for (unsigned int k = 0; k < order.size(); ++k) {
+		res += order[k].column + (order[k].descending ? "-" : "+");
+	}
+	return res + ".perm";
+}
+
+/**
+ * Query the permutation from the headers table of the database, sorted by
+ * order and then indexnumber.
+ */
+void SPPermutation::create(SPDB& db, vector<SPSortKey>& order) {
+	if (order.empty()) {
+		throw SPException("No sort order for the permutation");
+	}
+	stringstream ss;
+	ss << "select indexnumber, " << order[0].column
+			<< " from headers order by ";
+	for (unsigned int k = 0; k < order.size(); ++k) {
+		ss << order[k].column << (order[k].descending ? " DESC" : " ASC")
+				<< ", ";
+	}
+	ss << "indexnumber;";
+	descending = order[0].descending;
+	indexes.clear();
+	leading.clear();
+
+	sqlite3_stmt* statement = db.prepareStatement(ss, "permutation select");
+	for (;;) {
+		int rc = sqlite3_step(statement);
+		if (rc == SQLITE_DONE) {
+			break;
+		}
+		if (rc != SQLITE_ROW) {
+			sqlite3_finalize(statement);
+			throw SPException("unknown stepping result: ", rc);
+		}
+		indexes.push_back(sqlite3_column_int(statement, 0));
+		leading.push_back(sqlite3_column_int(statement, 1));
+	}
+	sqlite3_finalize(statement);
+}
+
+/**
+ * The file holds the magic, the direction of the leading key, the number of
+ * rows, the indexnumbers and the leading key values, in native byte order.
+ */
+void SPPermutation::write(const string& fileName) {
+	ofstream out(fileName.c_str(), ios_base::binary | ios_base::trunc);
+	if (!out.is_open()) {
+		throw SPException("Permutation file open failed: ", fileName);
+	}
+	int header[2] = { descending ? 1 : 0, size() };
+	out.write(magic, sizeof(magic));
+	out.write((const char*)header, sizeof(header));
+	if (size() > 0) {
+		out.write((const char*)&indexes[0], size() * sizeof(int));
+		out.write((const char*)&leading[0], size() * sizeof(int));
+	}
+	if (!out.good()) {
+		throw SPException("Permutation file write failed: ", fileName);
+	}
+}
+
+/**
+ * Whether there is a sidecar file of the database for the order that has
+ * been written after the last modification of the database. The times are
+ * compared in nanoseconds, and equal times count as outdated, as the
+ * database may have changed right after the file was written.
+ */
+bool SPPermutation::isCurrent(const string& dbPath, vector<SPSortKey>& order) {
+	string fileName = getFileName(dbPath, order);
+	struct stat db;
+	struct stat perm;
+	if (stat(fileName.c_str(), &perm) != 0 || stat(dbPath.c_str(), &db) != 0) {
+		return false;
+	}
+	if (perm.st_mtim.tv_sec < db.st_mtim.tv_sec
+			|| (perm.st_mtim.tv_sec == db.st_mtim.tv_sec
+					&& perm.st_mtim.tv_nsec <= db.st_mtim.tv_nsec)) {
+		SPVerbose::show(SPVerbose::ESSENTIAL, "Permutation file outdated: ",
+				fileName);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Read the sidecar file of the database for the order. Returns false if
+ * there is none, if the database has been modified after it was written,
+ * or if it does not have a row for every trace of the database.
+ */
+bool SPPermutation::read(const string& dbPath, vector<SPSortKey>& order) {
+	if (!isCurrent(dbPath, order)) {
+		return false;
+	}
+	string fileName = getFileName(dbPath, order);
+
+	ifstream in(fileName.c_str(), ios_base::binary);
+	char m[sizeof(magic)];
+	int header[2];
+	in.read(m, sizeof(m));
+	in.read((char*)header, sizeof(header));
+	if (!in.good() || memcmp(m, magic, sizeof(magic)) != 0 || header[1] < 0) {
+		throw SPException("Not a permutation file: ", fileName);
+	}
+	map<string, string>& meta = SPKVTable().read(dbPath, "meta");
+	if (header[1] != atoi(meta["numberoftraces"].c_str())) {
+		SPVerbose::show(SPVerbose::ESSENTIAL, "Permutation file ", fileName,
+				" does not match the number of traces");
+		return false;
+	}
+	descending = header[0] != 0;
+	indexes.resize(header[1]);
+	leading.resize(header[1]);
+	if (header[1] > 0) {
+		in.read((char*)&indexes[0], header[1] * sizeof(int));
+		in.read((char*)&leading[0], header[1] * sizeof(int));
+	}
+	if (!in.good()) {
+		throw SPException("Permutation file truncated: ", fileName);
+	}
+	SPVerbose::show(SPVerbose::ESSENTIAL, "Using permutation file: ",
+			fileName);
+	return true;
+}
+
+/**
+ * The rows [first, last) whose leading key is in [lower, upper].
+ */
+void SPPermutation::getRange(int lower, int upper, int& first, int& last) {
+	if (descending) {
+		first = lower_bound(leading.begin(), leading.end(), upper,
+				greater<int> ()) - leading.begin();
+		last = upper_bound(leading.begin(), leading.end(), lower,
+				greater<int> ()) - leading.begin();
+	} else {
+		first = lower_bound(leading.begin(), leading.end(), lower)
+				- leading.begin();
+		last = upper_bound(leading.begin(), leading.end(), upper)
+				- leading.begin();
+	}
+	if (last < first) {
+		last = first;
+	}
+}
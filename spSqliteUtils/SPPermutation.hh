@@ -0,0 +1,54 @@
+//============================================================================
+// Name        : SPPermutation.hh
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#ifndef SPPERMUTATION_HH_
+#define SPPERMUTATION_HH_
+
+#include <SPTable.hh>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+namespace SP {
+
+/**
+ * The indexnumbers of the headers table of a database in a fixed sort order,
+ * together with the values of the leading sort key. It is stored in a
+ * sidecar file next to the database, named after the sort order, so a
+ * selection in that order with at most a range on the leading key needs no
+ * query at all.
+ */
+class SPPermutation {
+public:
+	static string getFileName(const string& dbPath, vector<SPSortKey>& order);
+	static bool isCurrent(const string& dbPath, vector<SPSortKey>& order);
+
+	SPPermutation() {
+	}
+
+	void create(SPDB& db, vector<SPSortKey>& order);
+	void write(const string& fileName);
+	bool read(const string& dbPath, vector<SPSortKey>& order);
+
+	int size() {
+		return indexes.size();
+	}
+
+	int getIndex(int i) {
+		return indexes[i];
+	}
+
+	void getRange(int lower, int upper, int& first, int& last);
+
+private:
+	/** the order is descending on the leading key */
+	bool descending;
+	vector<int> indexes;
+	vector<int> leading;
+};
+}
+#endif /*SPPERMUTATION_HH_*/
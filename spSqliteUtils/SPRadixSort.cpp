@@ -0,0 +1,94 @@
+//============================================================================
+// Name        : SPRadixSort.cpp
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#include "SPRadixSort.hh"
+#include <thread>
+
+using namespace std;
+using namespace SP;
+
+SPRadixSort::SPRadixSort(int n, int threads) :
+	n(n), order(n), values(n), sortedOrder(n), sortedValues(n) {
+	// a thread needs enough rows to pay for itself
+	if (threads > n / 65536) {
+		threads = n / 65536;
+	}
+	this->threads = threads < 1 ? 1 : threads;
+	counts.resize(this->threads, vector<long long> (256));
+	for (int i = 0; i < n; ++i) {
+		order[i] = i;
+	}
+}
+
+/**
+ * Sort the rows stably by keys, which is indexed by row number.
+ */
+void SPRadixSort::sortBy(const unsigned int* keys) {
+	for (int i = 0; i < n; ++i) {
+		values[i] = keys[order[i]];
+	}
+	for (int shift = 0; shift < 32; shift += 8) {
+		pass(shift);
+	}
+}
+
+void SPRadixSort::pass(int shift) {
+	vector<thread> workers;
+	for (int t = 1; t < threads; ++t) {
+		workers.push_back(thread(&SPRadixSort::count, this, t, shift));
+	}
+	count(0, shift);
+	for (unsigned int t = 0; t < workers.size(); ++t) {
+		workers[t].join();
+	}
+
+	long long start = 0;
+	for (int b = 0; b < 256; ++b) {
+		long long total = 0;
+		for (int t = 0; t < threads; ++t) {
+			long long c = counts[t][b];
+			counts[t][b] = start + total;
+			total += c;
+		}
+		if (total == n) {
+			// all rows have the same byte
+			return;
+		}
+		start += total;
+	}
+
+	workers.clear();
+	for (int t = 1; t < threads; ++t) {
+		workers.push_back(thread(&SPRadixSort::scatter, this, t, shift));
+	}
+	scatter(0, shift);
+	for (unsigned int t = 0; t < workers.size(); ++t) {
+		workers[t].join();
+	}
+	order.swap(sortedOrder);
+	values.swap(sortedValues);
+}
+
+void SPRadixSort::count(int t, int shift) {
+	vector<long long>& c = counts[t];
+	c.assign(256, 0);
+	long long first = ((long long)n) * t / threads;
+	long long last = ((long long)n) * (t + 1) / threads;
+	for (long long i = first; i < last; ++i) {
+		++c[(values[i] >> shift) & 0xff];
+	}
+}
+
+void SPRadixSort::scatter(int t, int shift) {
+	vector<long long>& c = counts[t];
+	long long first = ((long long)n) * t / threads;
+	long long last = ((long long)n) * (t + 1) / threads;
+	for (long long i = first; i < last; ++i) {
+		long long k = c[(values[i] >> shift) & 0xff]++;
+		sortedOrder[k] = order[i];
+		sortedValues[k] = values[i];
+	}
+}
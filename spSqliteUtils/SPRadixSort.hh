@@ -0,0 +1,60 @@
+//============================================================================
+// Name        : SPRadixSort.hh
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#ifndef SPRADIXSORT_HH_
+#define SPRADIXSORT_HH_
+
+#include <vector>
+
+using namespace std;
+
+namespace SP {
+
+/**
+ * Stable LSD radix sort of row numbers by unsigned 32 bit keys. For a sort
+ * by several keys ::sortBy is called for each of them, the least significant
+ * key first. Each call sorts by one byte of the key at a time, with the rows
+ * split among the threads; bytes that are the same for all rows are skipped.
+ */
+class SPRadixSort {
+public:
+	SPRadixSort(int n, int threads);
+
+	void sortBy(const unsigned int* keys);
+
+	/**
+	 * The row numbers in sorted order.
+	 */
+	vector<unsigned int>& getOrder() {
+		return order;
+	}
+
+	/**
+	 * Map an int to an unsigned key of the same order, or of the reverse
+	 * order for a descending sort.
+	 */
+	static unsigned int key(int value, bool descending) {
+		unsigned int k = ((unsigned int)value) ^ 0x80000000u;
+		return descending ? ~k : k;
+	}
+
+private:
+	void pass(int shift);
+	void count(int t, int shift);
+	void scatter(int t, int shift);
+
+private:
+	int n;
+	int threads;
+	vector<unsigned int> order;
+	vector<unsigned int> values;
+	vector<unsigned int> sortedOrder;
+	vector<unsigned int> sortedValues;
+	/** per thread histogram, then per thread start of each bucket */
+	vector<vector<long long> > counts;
+};
+}
+#endif /*SPRADIXSORT_HH_*/
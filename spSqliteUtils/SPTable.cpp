@@ -5,7 +5,11 @@
 // Copyright   : SoftSeis, Norway, all rights reserved
 //============================================================================
 #include "SPTable.hh"
+#include "SPRadixSort.hh"
 #include <sstream>
+#include <algorithm>
+#include <ctype.h>
+#include <stdio.h>
 
 using namespace std;
 using namespace SP;
@@ -94,35 +98,201 @@ string SPDB::getUnionTable(const string& table, const string& fields,
 	stringstream ss;
 	for (unsigned int i = 0; i < dbs.size(); ++i) {
 		if (i > 0) {
-			ss << " union ";
-		}
-		ss << "select " << fields << "indexnumber, " << i << " as " << dbColumn
-				<< " from ";
-		if (dbs.size() > 1) {
-			ss << "db" << i << ".";
-		}
-		ss << table;
-		if (where.length() > 0) {
-			ss << " where " << where;
+			// the rows of different files differ in dbColumn anyway
+			ss << " union all ";
 		}
+		ss << getSelect(i, table, fields, where, dbColumn);
 	}
 	return ss.str();
 
 }
 
+/**
+ * The select of the rows of the table in the i-th database file, with i as
+ * dbColumn.
+ */
+string SPDB::getSelect(int i, const string& table, const string& fields,
+		const string& where, const string& dbColumn) {
+	stringstream ss;
+	ss << "select " << fields << "indexnumber, " << i << " as " << dbColumn
+			<< " from ";
+	if (dbs.size() > 1) {
+		ss << "db" << i << ".";
+	}
+	ss << table;
+	if (where.length() > 0) {
+		ss << " where " << where;
+	}
+	return ss.str();
+}
+
+/**
+ * The lines of EXPLAIN QUERY PLAN for the statement.
+ */
+vector<string> SPDB::explain(const string& sql) {
+	vector<string> plan;
+	stringstream ss;
+	ss << "explain query plan " << sql;
+	sqlite3_stmt* statement = prepareStatement(ss, "query plan");
+	while (sqlite3_step(statement) == SQLITE_ROW) {
+		const char* detail = (const char*)sqlite3_column_text(statement,
+				sqlite3_column_count(statement) - 1);
+		plan.push_back(detail == 0 ? "" : detail);
+	}
+	sqlite3_finalize(statement);
+	return plan;
+}
+
+/**
+ * Create an index on the table in the i-th database file unless it exists.
+ * The columns are given as in SQL, e.g. "cdp, offset DESC". As indexnumber
+ * is the rowid of the headers table, it is part of every index, which makes
+ * an index on the selection and sort columns covering for the queries of
+ * spdbread.
+ */
+void SPDB::createIndex(int i, const string& table, const string& columns) {
+	string name = table + "_";
+	for (unsigned int k = 0; k < columns.length(); ++k) {
+		char c = columns[k];
+		if (isalnum(c)) {
+			name += tolower(c);
+		} else if (name[name.length() - 1] != '_') {
+			name += '_';
+		}
+	}
+	stringstream ss;
+	ss << "create index if not exists ";
+	if (dbs.size() > 1) {
+		ss << "db" << i << ".";
+	}
+	ss << name << " on " << table << " (" << columns << ");";
+	SPVerbose::show(SPVerbose::ESSENTIAL, "Creating index ", name, " in ",
+			dbs[i]);
+	executeStatement(ss, "create index");
+}
+
+/**
+ * Settings for filling a new database in bulk: no journal, no syncing, a
+ * cache of cacheMB megabytes and pages of pageSize bytes. The page size
+ * only takes effect before the first table is created. A crash leaves a
+ * corrupt database behind, so this is only for databases that are built
+ * from scratch.
+ */
+void SPDB::setBulkLoad(int cacheMB, int pageSize) {
+	stringstream ss;
+	ss << "pragma page_size = " << pageSize << "; pragma journal_mode = off; "
+			<< "pragma synchronous = off; pragma cache_size = "
+			<< -cacheMB * 1024L << "; pragma temp_store = memory;";
+	executeStatement(ss, "bulk load settings");
+}
+
+/**
+ * Copy the main database, e.g. one built in memory, into the file with the
+ * backup API. The copy is written next to the file and renamed, so the file
+ * either does not change or has the complete database.
+ */
+void SPDB::saveTo(const string& file) {
+	string temporary = file + ".tmp";
+	sqlite3* target;
+	SPVerbose::show(SPVerbose::ESSENTIAL, "Saving database to ", file);
+	if (sqlite3_open_v2(temporary.c_str(), &target, SQLITE_OPEN_READWRITE
+			| SQLITE_OPEN_CREATE, 0) != SQLITE_OK) {
+		sqlite3_close(target);
+		throw SPException("Database open failed: ", temporary);
+	}
+	sqlite3_backup* backup = sqlite3_backup_init(target, "main", db, "main");
+	int rc = SQLITE_ERROR;
+	if (backup != 0) {
+		sqlite3_backup_step(backup, -1);
+		rc = sqlite3_backup_finish(backup);
+	}
+	sqlite3_close(target);
+	if (rc != SQLITE_OK) {
+		remove(temporary.c_str());
+		throw SPException("Saving database to ", file, " failed: ", rc);
+	}
+	if (rename(temporary.c_str(), file.c_str()) != 0) {
+		remove(temporary.c_str());
+		throw SPException("Renaming database to ", file, " failed");
+	}
+}
+
+/**
+ * Position of a new column of the size in the row record, 0 for the COLUMNS
+ * layout.
+ */
+int SPTable::placeColumn(int size) {
+	if (count > 0) {
+		throw SPException("Columns can not be added to a table with rows");
+	}
+	if (layout == COLUMNS) {
+		return 0;
+	}
+	int pos = ((end + size - 1)/size) * size;
+	end = pos + size;
+	return pos;
+}
+
+void SPTable::registerColumn(const string& name, SPAbstractPicker* p) {
+	if (rows != 0) {
+		// row size changes
+		delete rows;
+		rows = 0;
+	}
+	columns[name] = p;
+	columnIndex[name] = columnList.size();
+	columnList.push_back(p);
+	if (layout == COLUMNS) {
+		columnData.push_back(new SPArena(p->getSize()));
+	}
+}
+
+void SPTable::clearRows() {
+	if (rows != 0) {
+		rows->clear();
+	}
+	for (unsigned int i = 0; i < columnData.size(); ++i) {
+		columnData[i]->clear();
+	}
+	count = 0;
+}
+
 void SPTable::clean() {
-	for (unsigned int i = 0; i < data.size(); ++i) {
-		delete (char*)data[i];
+	closeSQL();
+	delete rows;
+	rows = 0;
+	for (unsigned int i = 0; i < columnData.size(); ++i) {
+		delete columnData[i];
 	}
-	data.clear();
+	columnData.clear();
+	for (unsigned int i = 0; i < columnList.size(); ++i) {
+		delete columnList[i];
+	}
+	columnList.clear();
+	columnIndex.clear();
 	columns.clear();
+	end = 0;
+	count = 0;
 }
 
 void SPTable::createTable(const string& dbName, const string& name) {
 	SPDB db(dbName);
-	stringstream ss;
-	sqlite3_stmt* statement;
+	createSchema(db, name);
+	sqlite3_stmt* statement = prepareInsert(db, name);
+
+	db.beginTransaction();
+	insertRows(statement);
+	db.commit();
 
+	sqlite3_finalize(statement);
+}
+
+/**
+ * Create the table with the columns of this table in the database, replacing
+ * an existing one.
+ */
+void SPTable::createSchema(SPDB& db, const string& name) {
+	stringstream ss;
 	ss << "drop table " << name << ";";
 	db.executeStatement(ss, "");
 
@@ -134,8 +304,14 @@ void SPTable::createTable(const string& dbName, const string& name) {
 	}
 	ss << " primary key (" << primaryKey << "));";
 	db.executeStatement(ss, "create data table");
+}
 
-	ss.str("");
+/**
+ * The insert statement for the rows of this table into the table created by
+ * ::createSchema.
+ */
+sqlite3_stmt* SPTable::prepareInsert(SPDB& db, const string& name) {
+	stringstream ss;
 	ss << "insert into " << name << " values (";
 	for (SPPickerBox::iterator i = columns.begin(); i != columns.end(); ++i) {
 		if (i != columns.begin()) {
@@ -144,18 +320,24 @@ void SPTable::createTable(const string& dbName, const string& name) {
 		ss << "?";
 	}
 	ss << ");";
-	statement = db.prepareStatement(ss, "data table inserts");
+	return db.prepareStatement(ss, "data table inserts");
+}
 
-	db.beginTransaction();
-	for (unsigned int i = 0; i < data.size(); ++i) {
+/**
+ * Insert all rows with the statement of ::prepareInsert. Transactions are up
+ * to the caller.
+ */
+void SPTable::insertRows(sqlite3_stmt* statement) {
+	for (int i = 0; i < count; ++i) {
 		int k = 1;
 		for (SPPickerBox::iterator iter = columns.begin(); iter
 				!= columns.end(); ++iter) {
 			SPAbstractPicker* p = iter->second;
+			void* area = getArea(i, columnIndex[iter->first]);
 			if (p->isInt()) {
-				sqlite3_bind_int(statement, k, p->getInt(data[i]));
+				sqlite3_bind_int(statement, k, p->getInt(area));
 			} else {
-				sqlite3_bind_double(statement, k, p->getDouble(data[i]));
+				sqlite3_bind_double(statement, k, p->getDouble(area));
 			}
 			++k;
 		}
@@ -164,61 +346,317 @@ void SPTable::createTable(const string& dbName, const string& name) {
 			throw SPException("data insertion failed: ", rc);
 		}
 		sqlite3_reset(statement);
-		if ((i + 1) % 1000 == 0) {
-			db.commit();
-			db.beginTransaction();
-		}
 	}
-	db.commit();
-
-	sqlite3_finalize(statement);
 }
 
 void SPTable::readBySQL(SPDB& db, stringstream& sql, SPPickerBox& typedefs,
 		int start, int stop) {
-	sqlite3_stmt* statement = db.prepareStatement(sql, "data select statement");
+	openSQL(db, sql, typedefs);
+	for (int i = 0; i < start && fetchRows(1) > 0; ++i) {
+	}
+	clearRows();
+	fetchRows(stop < 0 ? -1 : stop - start);
+	closeSQL();
+}
+
+void SPTable::openSQL(SPDB& db, stringstream& sql, SPPickerBox& typedefs) {
+	closeSQL();
+	cursor = db.prepareStatement(sql, "data select statement");
+	prepareColumns(cursor, typedefs);
+}
+
+/**
+ * Open queries with identical result columns, each sorted by order, and
+ * merge their results in that order. Rows equal in all columns of the order
+ * come in the order of the queries. This lets each query use the indexes of
+ * its own database instead of sorting all rows in one temporary B-tree.
+ */
+void SPTable::openSQL(SPDB& db, vector<string>& sql, SPPickerBox& typedefs,
+		vector<SPSortKey>& order) {
+	closeSQL();
+	for (unsigned int i = 0; i < sql.size(); ++i) {
+		stringstream ss(sql[i]);
+		merged.push_back(db.prepareStatement(ss, "data select statement"));
+	}
+	if (merged.empty()) {
+		return;
+	}
+	prepareColumns(merged[0], typedefs);
+
+	keyColumns.clear();
+	keyDescending.clear();
+	for (unsigned int k = 0; k < order.size(); ++k) {
+		int c = sqlite3_column_count(merged[0]) - 1;
+		while (c >= 0 && order[k].column != sqlite3_column_name(merged[0], c)) {
+			--c;
+		}
+		if (c < 0) {
+			throw SPException("No such column in the merged queries: ",
+					order[k].column);
+		}
+		keyColumns.push_back(c);
+		keyDescending.push_back(order[k].descending);
+	}
+
+	heap.clear();
+	for (unsigned int i = 0; i < merged.size(); ++i) {
+		int rc = sqlite3_step(merged[i]);
+		if (rc == SQLITE_ROW) {
+			heap.push_back(i);
+		} else if (rc != SQLITE_DONE) {
+			throw SPException("unknown stepping result: ", rc);
+		}
+	}
+	make_heap(heap.begin(), heap.end(), MergeOrder(this));
+}
 
-	int cols = sqlite3_column_count(statement);
-	SPAbstractPicker* fillers[cols];
+void SPTable::prepareColumns(sqlite3_stmt* s, SPPickerBox& typedefs) {
+	int cols = sqlite3_column_count(s);
+	fillers.clear();
 	for (int a = 0; a < cols; a++) {
-		string n = sqlite3_column_name(statement, a);
+		string n = sqlite3_column_name(s, a);
 		SPAbstractPicker* p = typedefs[n];
 		addColumn(n, p);
-		fillers[a] = getColumnPicker(n);
+		fillers.push_back(getColumnIndex(n));
 	}
+}
 
-	for (;;) {
-		int rc = sqlite3_step(statement);
-		int i;
+/**
+ * Order of the current rows of the merged queries a and b, in the way
+ * SQLite sorts them: NULL first, then numbers.
+ */
+int SPTable::compareRows(int a, int b) {
+	sqlite3_stmt* sa = merged[a];
+	sqlite3_stmt* sb = merged[b];
+	for (unsigned int k = 0; k < keyColumns.size(); ++k) {
+		int c = keyColumns[k];
+		int ta = sqlite3_column_type(sa, c);
+		int tb = sqlite3_column_type(sb, c);
+		int d = 0;
+		if (ta == SQLITE_NULL || tb == SQLITE_NULL) {
+			d = (ta != SQLITE_NULL) - (tb != SQLITE_NULL);
+		} else if (ta == SQLITE_INTEGER && tb == SQLITE_INTEGER) {
+			sqlite3_int64 va = sqlite3_column_int64(sa, c);
+			sqlite3_int64 vb = sqlite3_column_int64(sb, c);
+			d = (va > vb) - (va < vb);
+		} else {
+			double va = sqlite3_column_double(sa, c);
+			double vb = sqlite3_column_double(sb, c);
+			d = (va > vb) - (va < vb);
+		}
+		if (d != 0) {
+			return keyDescending[k] ? -d : d;
+		}
+	}
+	return (a > b) - (a < b);
+}
+
+/**
+ * Add the current row of the statement to the table.
+ */
+void SPTable::readRow(sqlite3_stmt* s) {
+	int i = addRow();
+	int cols = fillers.size();
+	for (int a = 0; a < cols; a++) {
+		int c = fillers[a];
+		switch (sqlite3_column_type(s, a)) {
+		case SQLITE_INTEGER:
+			columnList[c]->setInt(sqlite3_column_int(s, a), getArea(i, c));
+			break;
+		case SQLITE_FLOAT: {
+			columnList[c]->setDouble(sqlite3_column_double(s, a),
+					getArea(i, c));
+			break;
+		}
+		}
+	}
+}
+
+/**
+ * Replace the rows of the table with the next max rows (all if max < 0) of
+ * the open query. Returns the number of rows read, 0 at the end of the
+ * result.
+ */
+int SPTable::fetchRows(int max) {
+	clearRows();
+	if (!merged.empty()) {
+		return fetchMerged(max);
+	}
+	if (cursor == 0) {
+		return 0;
+	}
+	while (max < 0 || numberOfRows() < max) {
+		int rc = sqlite3_step(cursor);
 		switch (rc) {
 		case SQLITE_DONE:
-			sqlite3_finalize(statement);
-			return;
+			closeSQL();
+			return numberOfRows();
 		case SQLITE_ROW:
-			i = addRow();
-			for (int a = 0; a < cols; a++) {
-				switch (sqlite3_column_type(statement, a)) {
-				case SQLITE_INTEGER:
-					fillers[a]->setInt(sqlite3_column_int(statement, a),
-							getRowStart(i));
-					break;
-				case SQLITE_FLOAT: {
-					fillers[a]->setDouble(sqlite3_column_double(statement, a),
-							getRowStart(i));
-					break;
-				}
-				}
-			}
+			readRow(cursor);
 			break;
 		default:
 			throw SPException("unknown stepping result: ", rc);
 		}
 	}
+	return numberOfRows();
+}
+
+/**
+ * ::fetchRows for merged queries: take the row of the query on top of the
+ * heap and step that query.
+ */
+int SPTable::fetchMerged(int max) {
+	MergeOrder order(this);
+	while (!heap.empty() && (max < 0 || numberOfRows() < max)) {
+		pop_heap(heap.begin(), heap.end(), order);
+		int q = heap.back();
+		readRow(merged[q]);
+		int rc = sqlite3_step(merged[q]);
+		if (rc == SQLITE_ROW) {
+			push_heap(heap.begin(), heap.end(), order);
+		} else if (rc == SQLITE_DONE) {
+			heap.pop_back();
+		} else {
+			throw SPException("unknown stepping result: ", rc);
+		}
+	}
+	if (heap.empty()) {
+		closeSQL();
+	}
+	return numberOfRows();
+}
+
+/**
+ * Sort the rows in memory by the integer columns of order with a radix
+ * sort on up to threads threads. Rows equal in all columns of order keep
+ * their order.
+ */
+void SPTable::sortRows(vector<SPSortKey>& order, int threads) {
+	for (unsigned int k = 0; k < order.size(); ++k) {
+		SPAbstractPicker* p = columns[order[k].column];
+		if (p == 0 || !p->isInt()) {
+			throw SPException("No integer column to sort by: ",
+					order[k].column);
+		}
+	}
+	SPRadixSort sort(count, threads);
+	vector<unsigned int> keys(count);
+	for (int k = order.size() - 1; k >= 0; --k) {
+		int c = columnIndex[order[k].column];
+		SPAbstractPicker* p = columnList[c];
+		bool descending = order[k].descending;
+		for (int i = 0; i < count; ++i) {
+			keys[i] = SPRadixSort::key(p->getInt(getArea(i, c)), descending);
+		}
+		sort.sortBy(&keys[0]);
+	}
+	permuteRows(sort.getOrder());
+}
+
+/**
+ * Rearrange the rows so that row i is the former row order[i].
+ */
+void SPTable::permuteRows(vector<unsigned int>& order) {
+	if (rows != 0) {
+		rows = permute(rows, order);
+	}
+	for (unsigned int i = 0; i < columnData.size(); ++i) {
+		columnData[i] = permute(columnData[i], order);
+	}
+}
+
+SPArena* SPTable::permute(SPArena* arena, vector<unsigned int>& order) {
+	int stride = arena->getStride();
+	SPArena* res = new SPArena(stride);
+	for (unsigned int i = 0; i < order.size(); ++i) {
+		memcpy(res->at(res->add()), arena->at(order[i]), stride);
+	}
+	delete arena;
+	return res;
+}
+
+/**
+ * Exchange columns, rows and open query with the other table, so a query
+ * opened and partly read on one table can be continued on another.
+ */
+void SPTable::swap(SPTable& other) {
+	std::swap(layout, other.layout);
+	columns.swap(other.columns);
+	columnIndex.swap(other.columnIndex);
+	columnList.swap(other.columnList);
+	std::swap(end, other.end);
+	std::swap(count, other.count);
+	primaryKey.swap(other.primaryKey);
+	std::swap(rows, other.rows);
+	columnData.swap(other.columnData);
+	std::swap(cursor, other.cursor);
+	fillers.swap(other.fillers);
+	merged.swap(other.merged);
+	heap.swap(other.heap);
+	keyColumns.swap(other.keyColumns);
+	keyDescending.swap(other.keyDescending);
+}
+
+/**
+ * Add the columns of from, in the same order, to a table without columns.
+ * The pickers of from then work on the rows of this table as well.
+ */
+void SPTable::copyColumns(SPTable& from) {
+	vector<string> names(from.columnList.size());
+	for (SPMap<int>::iterator i = from.columnIndex.begin(); i
+			!= from.columnIndex.end(); ++i) {
+		names[i->second] = i->first;
+	}
+	setLayout(from.layout);
+	for (unsigned int c = 0; c < names.size(); ++c) {
+		addColumn(names[c], from.columnList[c]);
+	}
+	primaryKey = from.primaryKey;
+}
+
+/**
+ * Replace the rows with copies of the rows of from with the indexes in
+ * which, in that order. An empty table takes over the columns of from
+ * first, otherwise the columns must be the same.
+ */
+void SPTable::copyRows(SPTable& from, vector<unsigned int>& which) {
+	if (columnList.empty()) {
+		copyColumns(from);
+	}
+	clearRows();
+	int cols = columnList.size();
+	for (unsigned int i = 0; i < which.size(); ++i) {
+		int r = addRow();
+		for (int c = 0; c < cols; ++c) {
+			SPAbstractPicker* p = columnList[c];
+			SPAbstractPicker* q = from.columnList[c];
+			memcpy((char*)getArea(r, c) + p->getOffset(),
+					(char*)from.getArea(which[i], c) + q->getOffset(),
+					p->getSize());
+		}
+	}
+}
+
+void SPTable::closeSQL() {
+	if (cursor != 0) {
+		sqlite3_finalize(cursor);
+		cursor = 0;
+	}
+	for (unsigned int i = 0; i < merged.size(); ++i) {
+		sqlite3_finalize(merged[i]);
+	}
+	merged.clear();
+	heap.clear();
 }
 
 void SPKVTable::createTable(const string& dbName, const string& name,
 		map<string, string>& data) {
 	SPDB db(dbName);
+	createTable(db, name, data);
+}
+
+void SPKVTable::createTable(SPDB& db, const string& name,
+		map<string, string>& data) {
 	sqlite3_stmt* statement;
 	stringstream ss;
 
@@ -28,6 +28,14 @@ public:
 	void executeStatement(stringstream& sql, string op);
 	string getUnionTable(const string& table, const string& fields,
 			const string& where, const string& dbColumn);
+	string getSelect(int i, const string& table, const string& fields,
+			const string& where, const string& dbColumn);
+
+	vector<string> explain(const string& sql);
+	void createIndex(int i, const string& table, const string& columns);
+
+	void setBulkLoad(int cacheMB, int pageSize);
+	void saveTo(const string& file);
 
 	sqlite3* getDB() {
 		return db;
@@ -45,70 +53,182 @@ private:
 	sqlite3* db;
 };
 
+/**
+ * A column of the order the results of several queries are merged in by
+ * SPTable::openSQL.
+ */
+struct SPSortKey {
+	string column;
+	bool descending;
+};
+
+/**
+ * Storage for fixed size records, allocated in chunks of CHUNK records. The
+ * records of a chunk are contiguous. ::clear keeps the chunks for reuse, so
+ * a table filled over and over again does not allocate any more.
+ */
+class SPArena {
+public:
+	static const int SHIFT = 12;
+	static const int CHUNK = 1 << SHIFT;
+
+public:
+	SPArena(int stride) :
+		stride(stride), count(0) {
+	}
+
+	~SPArena() {
+		release();
+	}
+
+	int getStride() {
+		return stride;
+	}
+
+	int size() {
+		return count;
+	}
+
+	void* at(int i) {
+		return chunks[i >> SHIFT] + ((long)(i & (CHUNK - 1))) * stride;
+	}
+
+	int add() {
+		if ((unsigned int)(count >> SHIFT) == chunks.size()) {
+			chunks.push_back(new char[((long)stride) << SHIFT]);
+		}
+		return count++;
+	}
+
+	void clear() {
+		count = 0;
+	}
+
+	void release() {
+		for (unsigned int i = 0; i < chunks.size(); ++i) {
+			delete[] chunks[i];
+		}
+		chunks.clear();
+		count = 0;
+	}
+
+private:
+	int stride;
+	int count;
+	vector<char*> chunks;
+};
+
+/**
+ * In memory table of typed columns, filled from SEGY headers or from a query
+ * and written to a database table.
+ *
+ * By default the rows are records with all columns, so a row can be handed
+ * around as one pointer (::getRowStart) and the pickers of the columns work
+ * on it. In the COLUMNS layout each column is stored on its own, which makes
+ * scanning and sorting by a few columns cache friendly; the cell of a row is
+ * then found with ::getArea only. The layout must be chosen before the first
+ * column is added.
+ */
 class SPTable {
 
 public:
-	SPTable() {
+	enum Layout {
+		ROWS, COLUMNS
+	};
+
+public:
+	SPTable() :
+		layout(ROWS), end(0), count(0), rows(0), cursor(0) {
 	}
 
 	~SPTable() {
 		clean();
 	}
 
+	void setLayout(Layout l) {
+		if (!columnList.empty()) {
+			throw SPException("Table layout can not change with columns");
+		}
+		layout = l;
+	}
+
+	Layout getLayout() {
+		return layout;
+	}
+
 	template<typename T> SPPicker<T>* addColumn(const string& name,
 			void* description = 0) {
-		int size = sizeof(T);
-		int pos = ((end + size - 1)/size) * size;
-		end = pos + size;
-
-		SPPicker<T>* p = new SPPicker<T>(pos);
+		SPPicker<T>* p = new SPPicker<T>(placeColumn(sizeof(T)));
 		p->setProperties(description);
 
-		columns[name] = p;
+		registerColumn(name, p);
 		return p;
 	}
 
 	void addColumn(const string& name, SPAbstractPicker* ref,
 			void* description = 0) {
-		int size = ref->getSize();
-		int pos = ((end + size - 1)/size) * size;
-		end = pos + size;
-
-		SPAbstractPicker* p = ref->duplicate(pos);
+		SPAbstractPicker* p = ref->duplicate(placeColumn(ref->getSize()));
 		p->setProperties(description);
 
-		columns[name] = p;
+		registerColumn(name, p);
 	}
 
 	SPAbstractPicker* getColumnPicker(const string& name) {
 		return columns[name];
 	}
 
+	int getColumnIndex(const string& name) {
+		return columnIndex.hasName(name) ? columnIndex[name] : -1;
+	}
+
 	vector<string>& getColumnNames() {
 		return columns.getNames();
 	}
 
+	/**
+	 * The record of a row, only in the ROWS layout.
+	 */
 	void* getRowStart(int row) {
-		return data[row];
+		if (rows == 0) {
+			throw SPException("No row records in this table layout");
+		}
+		return rows->at(row);
+	}
+
+	/**
+	 * The memory the picker of the column with the index works on for the
+	 * row, in either layout.
+	 */
+	void* getArea(int row, int column) {
+		return layout == ROWS ? rows->at(row) : columnData[column]->at(row);
 	}
 
 	template<typename T> T get(const string& column, int row) {
-		return ((SPPicker<T>)
-				columns[column])->get(getRowStart(row));
+		return ((SPPicker<T>*)columns[column])->get(
+				getArea(row, columnIndex[column]));
 	}
 
 	template<typename T> void set(const string& column, int row, T value) {
 		((SPPicker<T>*)columns[column])->set(value,
-				getRowStart(row));
+				getArea(row, columnIndex[column]));
 	}
 
 	int addRow() {
-		data.push_back((void*)new char[end]);
-		return data.size() - 1;
+		if (layout == ROWS) {
+			if (rows == 0) {
+				rows = new SPArena((end + 7) / 8 * 8);
+			}
+			rows->add();
+		} else {
+			for (unsigned int i = 0; i < columnData.size(); ++i) {
+				columnData[i]->add();
+			}
+		}
+		return count++;
 	}
 
 	int numberOfRows() {
-		return data.size();
+		return count;
 	}
 
 	void setPrimaryKey(const string& key) {
@@ -116,16 +236,82 @@ public:
 	}
 
 	void createTable(const string& fileName, const string& name);
+	void createSchema(SPDB& db, const string& name);
+	sqlite3_stmt* prepareInsert(SPDB& db, const string& name);
+	void insertRows(sqlite3_stmt* statement);
 	void readBySQL(SPDB& db, stringstream& sql, SPPickerBox& typedefs,
 			int start = 0, int stop = -1);
 
+	/**
+	 * Streaming access to a query result: ::openSQL prepares the statement
+	 * and sets up the columns, each ::fetchRows replaces the rows of the
+	 * table with the next rows of the result, and ::closeSQL finishes the
+	 * statement. This keeps the memory bounded for results of any size.
+	 */
+	void openSQL(SPDB& db, stringstream& sql, SPPickerBox& typedefs);
+	void openSQL(SPDB& db, vector<string>& sql, SPPickerBox& typedefs,
+			vector<SPSortKey>& order);
+	int fetchRows(int max);
+	void closeSQL();
+
+	void sortRows(vector<SPSortKey>& order, int threads);
+
+	void swap(SPTable& other);
+	void copyColumns(SPTable& from);
+	void copyRows(SPTable& from, vector<unsigned int>& which);
+
+	void clearRows();
 	void clean();
 
 private:
+	int placeColumn(int size);
+	void registerColumn(const string& name, SPAbstractPicker* p);
+	void prepareColumns(sqlite3_stmt* s, SPPickerBox& typedefs);
+	void readRow(sqlite3_stmt* s);
+	int fetchMerged(int max);
+	int compareRows(int a, int b);
+	void permuteRows(vector<unsigned int>& order);
+	SPArena* permute(SPArena* arena, vector<unsigned int>& order);
+
+	/**
+	 * Heap order of the merged queries, the query with the next row on top.
+	 */
+	struct MergeOrder {
+		SPTable* table;
+		MergeOrder(SPTable* t) :
+			table(t) {
+		}
+		bool operator()(int a, int b) {
+			return table->compareRows(a, b) > 0;
+		}
+	};
+
+private:
+	Layout layout;
 	SPPickerBox columns;
+	SPMap<int> columnIndex;
+	vector<SPAbstractPicker*> columnList;
 	int end;
+	int count;
 	string primaryKey;
-	vector<void*> data;
+
+	/** row records in the ROWS layout */
+	SPArena* rows;
+	/** one arena per column in the COLUMNS layout */
+	vector<SPArena*> columnData;
+
+	/** the open query of ::openSQL */
+	sqlite3_stmt* cursor;
+	/** the columns the query result goes to */
+	vector<int> fillers;
+
+	/** the queries merged by ::fetchRows, each sorted in the merge order */
+	vector<sqlite3_stmt*> merged;
+	/** heap of the queries in merged that still have a row */
+	vector<int> heap;
+	/** result columns of the merge order */
+	vector<int> keyColumns;
+	vector<bool> keyDescending;
 };
 
 class SPKVTable {
@@ -144,6 +330,7 @@ public:
 
 	void createTable(const string& fileName, const string& name,
 			map<string, string>& data);
+	void createTable(SPDB& db, const string& name, map<string, string>& data);
 	map<string, string>& read(const string& fileName, const string& name);
 
 private:
@@ -0,0 +1,136 @@
+//============================================================================
+// Name        : SPTableWriter.cpp
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#include "SPTableWriter.hh"
+#include <chrono>
+
+using namespace std;
+using namespace SP;
+
+SPTableWriter::SPTableWriter(SPTable& prototype, const string& dbPath,
+		const string& name, int batchRows, int depth) :
+	db(dbPath), name(name), batchRows(batchRows < 1 ? 1 : batchRows),
+			insert(0), full(depth < 1 ? 1 : depth), empty(depth < 1 ? 1 : depth),
+			writer(0), done(false), failed(false) {
+	for (int i = 0; i < (depth < 1 ? 1 : depth); ++i) {
+		batches.push_back(new SPTable());
+		batches[i]->copyColumns(prototype);
+		empty.push(i);
+	}
+}
+
+SPTableWriter::~SPTableWriter() {
+	if (writer != 0) {
+		done = true;
+		writer->join();
+		delete writer;
+	}
+	if (insert != 0) {
+		sqlite3_finalize(insert);
+	}
+	for (unsigned int i = 0; i < batches.size(); ++i) {
+		delete batches[i];
+	}
+}
+
+/**
+ * Create the table, and whatever the subclass writes, and start the writer
+ * thread.
+ */
+void SPTableWriter::start() {
+	batches[0]->createSchema(db, name);
+	insert = batches[0]->prepareInsert(db, name);
+	prepare(db);
+	SPVerbose::show(SPVerbose::DATA, "Writing table ", name, " in batches of ",
+			batchRows);
+	writer = new thread(&SPTableWriter::run, this);
+}
+
+/**
+ * An empty batch to fill, waiting for one to be written if there is none.
+ */
+int SPTableWriter::acquire() {
+	int slot;
+	int spins = 0;
+	while (!empty.pop(slot)) {
+		check();
+		pause(spins);
+	}
+	batches[slot]->clearRows();
+	return slot;
+}
+
+void SPTableWriter::submit(int slot) {
+	check();
+	// there are only as many batches as places in the queue
+	full.push(slot);
+}
+
+/**
+ * Wait for all submitted batches to be written.
+ */
+void SPTableWriter::finish() {
+	if (writer == 0) {
+		return;
+	}
+	done = true;
+	writer->join();
+	delete writer;
+	writer = 0;
+	check();
+}
+
+void SPTableWriter::run() {
+	int slot;
+	int spins = 0;
+	try {
+		while (true) {
+			if (!full.pop(slot)) {
+				if (done) {
+					// a batch may have come right before done was set
+					if (!full.pop(slot)) {
+						return;
+					}
+				} else {
+					pause(spins);
+					continue;
+				}
+			}
+			spins = 0;
+			db.beginTransaction();
+			batches[slot]->insertRows(insert);
+			writeBatch(db, slot);
+			db.commit();
+			empty.push(slot);
+		}
+	} catch (SPException e) {
+		error = e.what();
+	} catch (...) {
+		error = "Unexpected exception writing table " + name;
+	}
+	failed = true;
+}
+
+/**
+ * Throw the error of the writer thread in the calling thread.
+ */
+void SPTableWriter::check() {
+	if (failed) {
+		throw SPException(error);
+	}
+}
+
+/**
+ * Wait for the other thread: spin for a short while, then sleep so an idle
+ * side does not take a core.
+ */
+void SPTableWriter::pause(int& spins) {
+	if (++spins < 64) {
+		this_thread::yield();
+	} else {
+		this_thread::sleep_for(chrono::microseconds(100));
+	}
+}
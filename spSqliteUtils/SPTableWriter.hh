@@ -0,0 +1,128 @@
+//============================================================================
+// Name        : SPTableWriter.hh
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#ifndef SPTABLEWRITER_HH_
+#define SPTABLEWRITER_HH_
+
+#include <SPTable.hh>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+namespace SP {
+
+/**
+ * Lock free queue between exactly one producer and one consumer thread,
+ * holding up to capacity items.
+ */
+template<typename T> class SPRing {
+public:
+	SPRing(int capacity) :
+		items(capacity + 1), head(0), tail(0) {
+	}
+
+	bool push(const T& item) {
+		unsigned int t = tail.load(memory_order_relaxed);
+		unsigned int n = t + 1 == items.size() ? 0 : t + 1;
+		if (n == head.load(memory_order_acquire)) {
+			return false;
+		}
+		items[t] = item;
+		tail.store(n, memory_order_release);
+		return true;
+	}
+
+	bool pop(T& item) {
+		unsigned int h = head.load(memory_order_relaxed);
+		if (h == tail.load(memory_order_acquire)) {
+			return false;
+		}
+		item = items[h];
+		head.store(h + 1 == items.size() ? 0 : h + 1, memory_order_release);
+		return true;
+	}
+
+private:
+	vector<T> items;
+	atomic<unsigned int> head;
+	atomic<unsigned int> tail;
+};
+
+/**
+ * Writes the rows of a table into a database table on a thread of its own
+ * while they are still being produced. The rows are filled into a fixed
+ * number of batches, tables with the columns of the prototype, which go to
+ * the writer thread and come back empty. The memory is thus bounded by the
+ * batches, and the producer waits when all of them are being written.
+ *
+ * Usage: ::acquire a batch, fill the rows of ::getRows with the pickers of
+ * the prototype, ::submit it; ::finish when done. Subclasses write more
+ * with each batch through ::prepare and ::writeBatch, in the same
+ * transaction and on the same connection.
+ */
+class SPTableWriter {
+public:
+	SPTableWriter(SPTable& prototype, const string& dbPath,
+			const string& name, int batchRows, int depth);
+	virtual ~SPTableWriter();
+
+	void start();
+	int acquire();
+	void submit(int slot);
+	void finish();
+
+	/**
+	 * The connection the table is written through, not to be used while
+	 * the writer thread runs.
+	 */
+	SPDB& getDB() {
+		return db;
+	}
+
+	SPTable& getRows(int slot) {
+		return *batches[slot];
+	}
+
+	int getBatchRows() {
+		return batchRows;
+	}
+
+	int getDepth() {
+		return batches.size();
+	}
+
+protected:
+	virtual void prepare(SPDB&) {
+	}
+
+	virtual void writeBatch(SPDB&, int) {
+	}
+
+private:
+	void run();
+	void check();
+	static void pause(int& spins);
+
+private:
+	SPDB db;
+	string name;
+	int batchRows;
+	vector<SPTable*> batches;
+	sqlite3_stmt* insert;
+
+	/** batches to be written, and batches free to be filled */
+	SPRing<int> full;
+	SPRing<int> empty;
+	thread* writer;
+	atomic<bool> done;
+	atomic<bool> failed;
+	string error;
+};
+}
+#endif /*SPTABLEWRITER_HH_*/
@@ -10,6 +10,12 @@
 #include <SPProcessor.hh>
 #include <SPAccessors.hh>
 #include <SPTable.hh>
+#include <SPConvert.hh>
+#include <SPRadixSort.hh>
+#include <SPTableWriter.hh>
+#include <SPParsers.hh>
+#include <algorithm>
+#include <header.h>
 #include <string>
 #include <sqlite3.h>
 
@@ -82,6 +88,227 @@ void stringReadTest() {
 	}
 }
 
+void ibmConversionTest() {
+	const int n = 10000;
+	int* in = new int[n];
+	int* ref = new int[n];
+	int* out = new int[n];
+
+	srand(17);
+	for (int i = 0; i < n; ++i) {
+		in[i] = (rand() << 16) ^ rand();
+	}
+	// zero, signed zero, overflow, underflow, zero mantissa
+	in[0] = 0;
+	in[1] = 0x80000000;
+	in[2] = 0x7fffffff;
+	in[3] = 0x00100000;
+	in[4] = 0x41000000;
+
+	for (int endian = 0; endian < 2; ++endian) {
+		// odd lengths run through the scalar tail of the kernels
+		for (int l = n - 7; l <= n; ++l) {
+			int b1 = SPConvert::ibmToFloatScalar(in, ref, l, endian);
+			int b2 = SPConvert::ibmToFloat(in, out, l, endian);
+			for (int i = 0; i < l; ++i) {
+				if (ref[i] != out[i]) {
+					throw SPException("IBM conversion mismatch at ", i, " with ",
+							SPConvert::getKernelName());
+				}
+			}
+			if (b1 != b2) {
+				throw SPException("IBM conversion bad value count ", b2,
+						" instead of ", b1);
+			}
+		}
+	}
+	cerr << "IBM conversion with " << SPConvert::getKernelName() << " ok"
+			<< endl;
+	delete[] in;
+	delete[] ref;
+	delete[] out;
+}
+
+void byteSwapTest() {
+	segy a;
+	segy b;
+	char* pa = (char*)&a;
+	char* pb = (char*)&b;
+
+	srand(23);
+	for (int i = 0; i < HDRBYTES + 4 * 1001; ++i) {
+		pa[i] = pb[i] = (char)rand();
+	}
+	for (int i = 0; i < SU_NKEYS; ++i) {
+		swaphval(&a, i);
+	}
+	SPConvert::swapHeader(pb);
+	for (int i = 0; i < HDRBYTES; ++i) {
+		if (pa[i] != pb[i]) {
+			throw SPException("Header swap mismatch at byte ", i);
+		}
+	}
+
+	for (int i = 0; i < 1001; ++i) {
+		swap_float_4(a.data + i);
+	}
+	SPConvert::swapFloats(b.data, 1001);
+	for (int i = 0; i < 1001; ++i) {
+		if (*(int*)(a.data + i) != *(int*)(b.data + i)) {
+			throw SPException("Sample swap mismatch at ", i);
+		}
+	}
+	cerr << "Byte swap with " << SPConvert::getKernelName() << " ok" << endl;
+}
+
+void decimateTest() {
+	float from[1001];
+	float to[1001];
+	for (int i = 0; i < 1001; ++i) {
+		from[i] = i * 0.25f;
+	}
+	for (int step = 1; step < 6; ++step) {
+		int n = 1000 / step + 1;
+		SPConvert::decimate(from, to, n, step);
+		for (int i = 0; i < n; ++i) {
+			if (to[i] != from[i * step]) {
+				throw SPException("Decimation mismatch at ", i);
+			}
+		}
+		// in place
+		float copy[1001];
+		memcpy(copy, from, sizeof(from));
+		SPConvert::decimate(copy, copy, n, step);
+		if (memcmp(copy, to, n * sizeof(float)) != 0) {
+			throw SPException("In place decimation mismatch for step ", step);
+		}
+	}
+	cerr << "Decimation ok" << endl;
+}
+
+void tableLayoutTest() {
+	SPTable rows;
+	SPTable cols;
+	cols.setLayout(SPTable::COLUMNS);
+	SPTable* t[] = { &rows, &cols };
+	for (int k = 0; k < 2; ++k) {
+		t[k]->addColumn<int>("cdp");
+		t[k]->addColumn<short>("offset");
+		t[k]->addColumn<double>("sx");
+		for (int i = 0; i < 3 * SPArena::CHUNK + 5; ++i) {
+			int r = t[k]->addRow();
+			t[k]->set<int>("cdp", r, i);
+			t[k]->set<short>("offset", r, (short)-i);
+			t[k]->set<double>("sx", r, i * 0.5);
+		}
+	}
+	for (int i = 0; i < rows.numberOfRows(); ++i) {
+		if (rows.get<int>("cdp", i) != cols.get<int>("cdp", i)
+				|| rows.get<short>("offset", i) != (short)-i
+				|| cols.get<short>("offset", i) != (short)-i
+				|| rows.get<double>("sx", i) != cols.get<double>("sx", i)) {
+			throw SPException("Table layouts differ at row ", i);
+		}
+	}
+	cols.clearRows();
+	if (cols.numberOfRows() != 0 || cols.addRow() != 0) {
+		throw SPException("Table rows not cleared");
+	}
+	cerr << "Table layouts ok" << endl;
+}
+
+struct ByKeys {
+	vector<int>& a;
+	vector<int>& b;
+	ByKeys(vector<int>& a, vector<int>& b) :
+		a(a), b(b) {
+	}
+	bool operator()(unsigned int i, unsigned int j) {
+		if (a[i] != a[j]) {
+			return a[i] > a[j];
+		}
+		return b[i] < b[j];
+	}
+};
+
+void ringTest() {
+	SPRing<int> ring(3);
+	const int n = 1000000;
+	long long sum = 0;
+	thread consumer([&ring, &sum]() {
+		int v;
+		for (int i = 0; i < n; ++i) {
+			while (!ring.pop(v)) {
+				this_thread::yield();
+			}
+			if (v != i) {
+				throw SPException("Ring order broken at ", i);
+			}
+			sum += v;
+		}
+	});
+	for (int i = 0; i < n; ++i) {
+		while (!ring.push(i)) {
+			this_thread::yield();
+		}
+	}
+	consumer.join();
+	if (sum != (long long)n * (n - 1) / 2) {
+		throw SPException("Ring lost items");
+	}
+	cerr << "Ring ok" << endl;
+}
+
+void radixSortTest() {
+	int n = 300000;
+	vector<int> a(n);
+	vector<int> b(n);
+	vector<unsigned int> ka(n);
+	vector<unsigned int> kb(n);
+	srand(7);
+	for (int i = 0; i < n; ++i) {
+		a[i] = rand() % 1000 - 500;
+		b[i] = rand() - RAND_MAX / 2;
+		ka[i] = SPRadixSort::key(a[i], true);
+		kb[i] = SPRadixSort::key(b[i], false);
+	}
+	SPRadixSort sort(n, 4);
+	sort.sortBy(&kb[0]);
+	sort.sortBy(&ka[0]);
+
+	vector<unsigned int> expected(n);
+	for (int i = 0; i < n; ++i) {
+		expected[i] = i;
+	}
+	stable_sort(expected.begin(), expected.end(), ByKeys(a, b));
+	if (expected != sort.getOrder()) {
+		throw SPException("Radix sort order differs");
+	}
+	cerr << "Radix sort ok" << endl;
+}
+
+void selectionTest() {
+	SPSelection forward(string("cdp+(50:100:25)"));
+	if (forward.getGroups()[0]->getWhere() != "(cdp in (50, 75, 100))") {
+		throw SPException("Wrong predicate: ",
+				forward.getGroups()[0]->getWhere());
+	}
+	// a reversed range with increment selects nothing
+	SPSelection reversed(string("cdp+(100:50:2)"));
+	if (reversed.getGroups()[0]->getWhere() != "(0)") {
+		throw SPException("Wrong predicate: ",
+				reversed.getGroups()[0]->getWhere());
+	}
+	cerr << "Selection ok" << endl;
+}
+
 int main(int argc, char **argv) {
+	ibmConversionTest();
+	byteSwapTest();
+	decimateTest();
+	tableLayoutTest();
+	radixSortTest();
+	ringTest();
+	selectionTest();
 	stringTableReadTest();
 }
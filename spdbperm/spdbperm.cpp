@@ -0,0 +1,116 @@
+//============================================================================
+// Name        : spdbperm.cpp
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+
+#define _FILE_OFFSET_BITS 64
+
+#include <iostream>
+#include <sstream>
+#include <SPProcessor.hh>
+#include <SPTable.hh>
+#include <SPPermutation.hh>
+#include <string>
+
+using namespace std;
+using namespace SP;
+
+class spdbperm : public SPProcessor {
+public:
+	void init();
+
+private:
+	vector<SPSortKey> parseOrder(const string& spec);
+};
+
+void spdbperm::init() {
+
+	stop();
+
+	SPVerbose::setVerboseLevel(getIntParameter("verbose", 0));
+
+	if (!hasParameter("dbpath")) {
+		throw SPException("No dbpath given, shutting down");
+	}
+	string dbpath = getStringParameter("dbpath");
+	SPVerbose::show(SPVerbose::ESSENTIAL, "Parameter found: dbpath=", dbpath);
+
+	if (!hasParameter("orders")) {
+		throw SPException("No orders given, shutting down");
+	}
+	string orders = getStringParameter("orders");
+	SPVerbose::show(SPVerbose::ESSENTIAL, "Parameter found: orders=", orders);
+
+	SPDB db(dbpath);
+	stringstream ss(orders);
+	string spec;
+	while (getline(ss, spec, '/')) {
+		vector<SPSortKey> order = parseOrder(spec);
+		string fileName = SPPermutation::getFileName(dbpath, order);
+		SPPermutation perm;
+		perm.create(db, order);
+		perm.write(fileName);
+		SPVerbose::show(SPVerbose::ESSENTIAL, "Written ", perm.size(),
+				" rows to ", fileName);
+	}
+}
+
+/**
+ * Columns separated by '|', each followed by '+' or '-' for the direction.
+ */
+vector<SPSortKey> spdbperm::parseOrder(const string& spec) {
+	vector<SPSortKey> order;
+	stringstream ss(spec);
+	string column;
+	while (getline(ss, column, '|')) {
+		char c = column.length() > 0 ? column[column.length() - 1] : ' ';
+		if (c != '+' && c != '-') {
+			throw SPException("No sort direction for column: ", column);
+		}
+		SPSortKey k = { column.substr(0, column.length() - 1), c == '-' };
+		order.push_back(k);
+	}
+	return order;
+}
+
+/// This is the normal code for the program driver.
+int main(int argc, char **argv) {
+	return (new spdbperm())->localMain(argc, argv);
+}
+
+// make SU doc happy
+const char
+		* sdoc[] = {
+				"SPDBPERM - store sort orders of an index db for spdbread",
+				"",
+				" spdbperm dbpath= orders= [optional parameters]",
+				"",
+				" Required parameters:",
+				"",
+				"      dbpath=    path to the database file created by spdbwrite.",
+				"",
+				"      orders=    the sort orders to store, in the syntax of the",
+				"                 select parameter of spdbread without ranges,",
+				"                 separated by '/', e.g. cdp+|offset+/gx+|sx+",
+				"",
+				" Optional parameters:",
+				"",
+				"      verbose=0  level of log messages.",
+				"",
+				" Notes:",
+				"",
+				"      Each order is written to a file next to the database, named",
+				"      after the order, e.g. data.db.cdp+offset+.perm. It holds the",
+				"      indexnumbers in that order and the values of the leading",
+				"      column. spdbread reads the traces of a select= with the same",
+				"      order and at most values or ranges on the leading column",
+				"      from the file instead of querying the database. The file is",
+				"      ignored once the database has been changed after it; run",
+				"      spdbperm again then.",
+				"",
+				" Examples:",
+				"",
+				"    spdbperm dbpath=seisdata.db orders='cdp+|offset+/fldr+|tracf+'",
+				0 };
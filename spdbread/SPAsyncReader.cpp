@@ -0,0 +1,322 @@
+//============================================================================
+// Name        : SPAsyncReader.cpp
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+
+#define _FILE_OFFSET_BITS 64
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#include "SPAsyncReader.hh"
+
+using namespace std;
+using namespace SP;
+
+SPAsyncReader* SPAsyncReader::create(int depth, bool useRing) {
+	SPAsyncReader* r = 0;
+#ifdef __linux__
+	if (useRing) {
+		r = SPRingReader::create(depth);
+	}
+#endif
+	if (r == 0) {
+		r = new SPThreadPoolReader(depth);
+	}
+	SPVerbose::show(SPVerbose::DATA, "Asynchronous reads with ", r->getName(),
+			", queue depth ", depth);
+	return r;
+}
+
+SPThreadPoolReader::SPThreadPoolReader(int depth) :
+	SPAsyncReader(depth), stopping(false) {
+	for (int i = 0; i < depth; ++i) {
+		workers.push_back(thread(&SPThreadPoolReader::work, this));
+	}
+}
+
+SPThreadPoolReader::~SPThreadPoolReader() {
+	{
+		unique_lock<mutex> l(lock);
+		stopping = true;
+	}
+	jobReady.notify_all();
+	for (unsigned int i = 0; i < workers.size(); ++i) {
+		workers[i].join();
+	}
+}
+
+void SPThreadPoolReader::submit(int fd, char* buffer, long long length,
+		long long offset, int tag) {
+	Job j;
+	j.fd = fd;
+	j.buffer = buffer;
+	j.length = length;
+	j.offset = offset;
+	j.tag = tag;
+	j.error = 0;
+	{
+		unique_lock<mutex> l(lock);
+		jobs.push_back(j);
+		++pending;
+	}
+	jobReady.notify_one();
+}
+
+int SPThreadPoolReader::wait() {
+	unique_lock<mutex> l(lock);
+	if (pending == 0) {
+		throw SPException("Waiting for a read with none submitted");
+	}
+	while (done.empty()) {
+		jobDone.wait(l);
+	}
+	return take();
+}
+
+int SPThreadPoolReader::poll() {
+	unique_lock<mutex> l(lock);
+	if (done.empty()) {
+		return -1;
+	}
+	return take();
+}
+
+/**
+ * The tag of the first finished job, with the lock held.
+ */
+int SPThreadPoolReader::take() {
+	Job j = done.front();
+	done.pop_front();
+	--pending;
+	if (j.error != 0) {
+		throw SPException("Asynchronous read failed at ", j.offset, ": ",
+				j.error);
+	}
+	return j.tag;
+}
+
+void SPThreadPoolReader::work() {
+	for (;;) {
+		Job j;
+		{
+			unique_lock<mutex> l(lock);
+			while (jobs.empty() && !stopping) {
+				jobReady.wait(l);
+			}
+			if (stopping) {
+				return;
+			}
+			j = jobs.front();
+			jobs.pop_front();
+		}
+		while (j.length > 0) {
+			ssize_t n = pread(j.fd, j.buffer, j.length, j.offset);
+			if (n <= 0) {
+				j.error = n < 0 ? errno : EIO;
+				break;
+			}
+			j.buffer += n;
+			j.offset += n;
+			j.length -= n;
+		}
+		{
+			unique_lock<mutex> l(lock);
+			done.push_back(j);
+		}
+		jobDone.notify_one();
+	}
+}
+
+#ifdef __linux__
+
+SPRingReader* SPRingReader::create(int depth) {
+	SPRingReader* r = new SPRingReader(depth);
+	if (!r->setup()) {
+		SPVerbose::show(SPVerbose::DATA, "io_uring not available: ", errno);
+		delete r;
+		return 0;
+	}
+	return r;
+}
+
+bool SPRingReader::setup() {
+	sqRing = cqRing = MAP_FAILED;
+	sqes = (io_uring_sqe*)MAP_FAILED;
+
+	io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	ring = syscall(__NR_io_uring_setup, depth, &p);
+	if (ring < 0) {
+		return false;
+	}
+
+	sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		sqRingSize = cqRingSize = sqRingSize > cqRingSize ? sqRingSize
+				: cqRingSize;
+	}
+	sqRing = mmap(0, sqRingSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+	if (sqRing == MAP_FAILED) {
+		return false;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		cqRing = sqRing;
+	} else {
+		cqRing = mmap(0, cqRingSize, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+		if (cqRing == MAP_FAILED) {
+			return false;
+		}
+	}
+	sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+	sqes = (io_uring_sqe*)mmap(0, sqesSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		return false;
+	}
+
+	char* sq = (char*)sqRing;
+	char* cq = (char*)cqRing;
+	sqTail = (unsigned*)(sq + p.sq_off.tail);
+	sqMask = (unsigned*)(sq + p.sq_off.ring_mask);
+	sqArray = (unsigned*)(sq + p.sq_off.array);
+	cqHead = (unsigned*)(cq + p.cq_off.head);
+	cqTail = (unsigned*)(cq + p.cq_off.tail);
+	cqMask = (unsigned*)(cq + p.cq_off.ring_mask);
+	cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+
+	depth = p.sq_entries < (unsigned)depth ? p.sq_entries : depth;
+	slots.resize(depth);
+	for (int i = 0; i < depth; ++i) {
+		slots[i].io = new iovec;
+		freeSlots.push_back(i);
+	}
+	return true;
+}
+
+SPRingReader::~SPRingReader() {
+	if (sqes != MAP_FAILED) {
+		munmap(sqes, sqesSize);
+	}
+	if (cqRing != MAP_FAILED && cqRing != sqRing) {
+		munmap(cqRing, cqRingSize);
+	}
+	if (sqRing != MAP_FAILED) {
+		munmap(sqRing, sqRingSize);
+	}
+	if (ring >= 0) {
+		close(ring);
+	}
+	for (unsigned int i = 0; i < slots.size(); ++i) {
+		delete slots[i].io;
+	}
+}
+
+/**
+ * Put the read described by the slot into the submission queue and let the
+ * kernel know about it.
+ */
+void SPRingReader::push(int slot) {
+	Slot& s = slots[slot];
+	s.io->iov_base = s.buffer;
+	s.io->iov_len = s.length;
+
+	unsigned tail = *sqTail;
+	unsigned index = tail & *sqMask;
+	io_uring_sqe* sqe = &sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_READV;
+	sqe->fd = s.fd;
+	sqe->addr = (unsigned long)s.io;
+	sqe->len = 1;
+	sqe->off = s.offset;
+	sqe->user_data = slot;
+	sqArray[index] = index;
+	__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+	if (syscall(__NR_io_uring_enter, ring, 1, 0, 0, 0, 0) < 0) {
+		throw SPException("io_uring submission failed: ", errno);
+	}
+}
+
+void SPRingReader::submit(int fd, char* buffer, long long length,
+		long long offset, int tag) {
+	if (freeSlots.empty()) {
+		throw SPException("io_uring queue depth exceeded: ", depth);
+	}
+	int slot = freeSlots.back();
+	freeSlots.pop_back();
+	Slot& s = slots[slot];
+	s.fd = fd;
+	s.buffer = buffer;
+	s.length = length;
+	s.offset = offset;
+	s.tag = tag;
+	++pending;
+	push(slot);
+}
+
+int SPRingReader::wait() {
+	if (pending == 0) {
+		throw SPException("Waiting for a read with none submitted");
+	}
+	return reap(true);
+}
+
+int SPRingReader::poll() {
+	return pending == 0 ? -1 : reap(false);
+}
+
+/**
+ * The tag of the next completed read, waiting for one if block is set,
+ * otherwise -1 if there is none yet. Short reads are resubmitted for the
+ * rest.
+ */
+int SPRingReader::reap(bool block) {
+	for (;;) {
+		unsigned head = *cqHead;
+		if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+			if (!block) {
+				return -1;
+			}
+			if (syscall(__NR_io_uring_enter, ring, 0, 1,
+					IORING_ENTER_GETEVENTS, 0, 0) < 0 && errno != EINTR) {
+				throw SPException("io_uring wait failed: ", errno);
+			}
+			continue;
+		}
+		io_uring_cqe* cqe = &cqes[head & *cqMask];
+		int slot = cqe->user_data;
+		int res = cqe->res;
+		__atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+
+		Slot& s = slots[slot];
+		if (res <= 0) {
+			throw SPException("Asynchronous read failed at ", s.offset, ": ",
+					-res);
+		}
+		if (res < s.length) { // short read, get the rest
+			s.buffer += res;
+			s.offset += res;
+			s.length -= res;
+			push(slot);
+			continue;
+		}
+		freeSlots.push_back(slot);
+		--pending;
+		return s.tag;
+	}
+}
+
+#endif
@@ -0,0 +1,170 @@
+//============================================================================
+// Name        : SPAsyncReader.hh
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#ifndef SPASYNCREADER_HH_
+#define SPASYNCREADER_HH_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <SPBaseUtil.hh>
+
+using namespace std;
+
+namespace SP {
+
+/**
+ * Engine for reads that run in the background. A read is submitted with a
+ * tag chosen by the caller, and ::wait returns the tag of a finished read,
+ * ::poll the same without blocking, or -1 if none has finished. Reads are
+ * always completed in full; a failed read throws SPException from ::wait or
+ * ::poll. Use ::create to get the best engine the system supports.
+ */
+class SPAsyncReader {
+public:
+	/**
+	 * An io_uring engine if useRing is set and the kernel supports it,
+	 * otherwise a pool of depth threads doing pread.
+	 */
+	static SPAsyncReader* create(int depth, bool useRing);
+
+	virtual ~SPAsyncReader() {
+	}
+
+	int getDepth() {
+		return depth;
+	}
+
+	int getPending() {
+		return pending;
+	}
+
+	virtual string getName() = 0;
+	virtual void submit(int fd, char* buffer, long long length,
+			long long offset, int tag) = 0;
+	virtual int wait() = 0;
+	virtual int poll() = 0;
+
+protected:
+	SPAsyncReader(int depth) :
+		depth(depth), pending(0) {
+	}
+
+protected:
+	/** max number of reads in flight */
+	int depth;
+	/** number of reads submitted but not yet returned by ::wait */
+	int pending;
+};
+
+/**
+ * The fallback engine: a pool of threads doing blocking preads.
+ */
+class SPThreadPoolReader : public SPAsyncReader {
+public:
+	SPThreadPoolReader(int depth);
+	~SPThreadPoolReader();
+
+	string getName() {
+		return "thread pool";
+	}
+
+	void submit(int fd, char* buffer, long long length, long long offset,
+			int tag);
+	int wait();
+	int poll();
+
+private:
+	struct Job {
+		int fd;
+		char* buffer;
+		long long length;
+		long long offset;
+		int tag;
+		int error;
+	};
+
+	void work();
+	int take();
+
+private:
+	vector<thread> workers;
+	mutex lock;
+	condition_variable jobReady;
+	condition_variable jobDone;
+	deque<Job> jobs;
+	deque<Job> done;
+	bool stopping;
+};
+
+#ifdef __linux__
+
+/**
+ * Engine submitting the reads through an io_uring of the kernel. The ring is
+ * driven by the raw system calls, so no liburing is needed.
+ */
+class SPRingReader : public SPAsyncReader {
+public:
+	/**
+	 * Returns 0 if the kernel does not support io_uring.
+	 */
+	static SPRingReader* create(int depth);
+	~SPRingReader();
+
+	string getName() {
+		return "io_uring";
+	}
+
+	void submit(int fd, char* buffer, long long length, long long offset,
+			int tag);
+	int wait();
+	int poll();
+
+private:
+	SPRingReader(int depth) :
+		SPAsyncReader(depth) {
+	}
+
+	bool setup();
+	void push(int slot);
+	int reap(bool block);
+
+private:
+	struct Slot {
+		int fd;
+		char* buffer;
+		long long length;
+		long long offset;
+		int tag;
+		struct iovec* io;
+	};
+
+	int ring;
+	void* sqRing;
+	void* cqRing;
+	size_t sqRingSize;
+	size_t cqRingSize;
+	struct io_uring_sqe* sqes;
+	size_t sqesSize;
+
+	unsigned* sqTail;
+	unsigned* sqMask;
+	unsigned* sqArray;
+	unsigned* cqHead;
+	unsigned* cqTail;
+	unsigned* cqMask;
+	struct io_uring_cqe* cqes;
+
+	vector<Slot> slots;
+	vector<int> freeSlots;
+};
+
+#endif
+}
+#endif /*SPASYNCREADER_HH_*/
@@ -0,0 +1,79 @@
+//============================================================================
+// Name        : SPCostEstimator.cpp
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#include "SPCostEstimator.hh"
+
+using namespace std;
+using namespace SP;
+
+SPCostEstimator::SPCostEstimator(SPFileReader** files, int numberOfFiles,
+		bool readsData) :
+	files(files), readsData(readsData), costs(numberOfFiles) {
+	reset();
+}
+
+void SPCostEstimator::reset() {
+	for (unsigned int i = 0; i < costs.size(); ++i) {
+		FileCost& c = costs[i];
+		c.traces = 0;
+		c.distinct = 0;
+		c.seeks = 0;
+		c.distance = 0;
+		c.last = -1;
+		c.touched.assign(files[i]->getNumberOfTraces(), false);
+	}
+}
+
+/**
+ * Count the trace as the next one read. A trace not right behind the one
+ * read before from the same file takes a seek.
+ */
+void SPCostEstimator::add(int fileid, int index) {
+	FileCost& c = costs[fileid];
+	++c.traces;
+	if (!readsData) {
+		return;
+	}
+	if (index != c.last + 1) {
+		++c.seeks;
+		long long d = index - (c.last + 1LL);
+		c.distance += (d < 0 ? -d : d) * files[fileid]->getRecordLength();
+	}
+	c.last = index;
+	if (index >= 0 && index < (int)c.touched.size() && !c.touched[index]) {
+		c.touched[index] = true;
+		++c.distinct;
+	}
+}
+
+void SPCostEstimator::report(ostream& o, int group) {
+	long long traces = 0;
+	long long bytes = 0;
+	long long seeks = 0;
+	long long distance = 0;
+	int used = 0;
+	for (unsigned int i = 0; i < costs.size(); ++i) {
+		FileCost& c = costs[i];
+		traces += c.traces;
+		if (readsData) {
+			bytes += c.traces * files[i]->getReadSize();
+		}
+		seeks += c.seeks;
+		distance += c.distance;
+		used += readsData && c.traces > 0;
+	}
+	o << "Group #" << group << ": " << traces << " traces, " << bytes
+			<< " bytes from " << used << " of " << costs.size() << " files, "
+			<< seeks << " seeks over " << distance << " bytes" << endl;
+	for (unsigned int i = 0; i < costs.size(); ++i) {
+		FileCost& c = costs[i];
+		int n = files[i]->getNumberOfTraces();
+		o << "    " << files[i]->getDataPath() << ": " << c.traces
+				<< " traces, " << c.seeks << " seeks, " << c.distinct << " of "
+				<< n << " traces touched (" << (n > 0 ? 100.0 * c.distinct / n
+				: 0.0) << "%)" << endl;
+	}
+}
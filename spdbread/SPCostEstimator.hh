@@ -0,0 +1,50 @@
+//============================================================================
+// Name        : SPCostEstimator.hh
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#ifndef SPCOSTESTIMATOR_HH_
+#define SPCOSTESTIMATOR_HH_
+
+#include <vector>
+#include <iostream>
+#include "SPFileReader.hh"
+
+using namespace std;
+
+namespace SP {
+
+/**
+ * Counts what reading the traces of a group would cost, without reading
+ * them: traces, bytes, the seeks between traces that are not adjacent in
+ * their file in the order they are requested, and the part of each file
+ * that is touched. Without readsData the traces come from the database
+ * only, and nothing of the files is counted.
+ */
+class SPCostEstimator {
+public:
+	SPCostEstimator(SPFileReader** files, int numberOfFiles, bool readsData);
+
+	void reset();
+	void add(int fileid, int index);
+	void report(ostream& o, int group);
+
+private:
+	struct FileCost {
+		long long traces;
+		long long distinct;
+		long long seeks;
+		/** sum of the seek distances in bytes */
+		long long distance;
+		int last;
+		vector<bool> touched;
+	};
+
+private:
+	SPFileReader** files;
+	bool readsData;
+	vector<FileCost> costs;
+};
+}
+#endif /*SPCOSTESTIMATOR_HH_*/
@@ -0,0 +1,303 @@
+//============================================================================
+// Name        : SPFileReader.cpp
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+
+#define _FILE_OFFSET_BITS 64
+
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include "SPFileReader.hh"
+#include <SPConvert.hh>
+#include <SPTable.hh>
+
+using namespace std;
+using namespace SP;
+
+#undef open
+
+/**
+ * Without openData only the layout is known, the data file is not opened
+ * and no traces can be read.
+ */
+SPFileReader::SPFileReader(const string& dbPath, const string& dataPath,
+		bool openData) {
+	SPVerbose::show(SPVerbose::DATA, "Initializing for db: ", dbPath);
+
+	if (!fileSize(dbPath)) {
+		throw SPException("File for database not found: ", dbPath);
+	}
+
+	map<string, string>& meta = (new SPKVTable())->read(dbPath, "meta");
+
+	datapath = dataPath == "" ? meta["datapath"] : dataPath;
+	segytape = meta["segytape"] == "true";
+	fortran = meta["fortran"] == "true";
+
+	byteswap = segytape != bigEndianMachine();
+	ibmfloat = true;
+
+	dt = atoi(meta["dt"].c_str());
+	ns = atoi(meta["ns"].c_str());
+	scalel = atoi(meta["scalel"].c_str());
+	scalco = atoi(meta["scalco"].c_str());
+	nrTraces = atoi(meta["numberoftraces"].c_str());
+
+	traceSize = 240 + ns * 4;
+	readSize = traceSize;
+	windowFirst = 0;
+	windowCount = ns;
+	windowStep = 1;
+	recordLength = traceSize;
+	headerOffset = 0;
+	if (fortran) {
+		recordLength += 8;
+		headerOffset += 4;
+	}
+	if (segytape) {
+		headerOffset += 3600;
+		if (fortran) {
+			headerOffset += 16;
+		}
+	}
+	store = (segy*)new char[traceSize];
+	fd = -1;
+	mapping = 0;
+	mapSize = 0;
+	if (!openData) {
+		return;
+	}
+
+	long long fs = fileSize(datapath);
+	long long dl = ((long long)recordLength) * nrTraces + headerOffset - 4;
+	if (fs < dl) {
+		throw SPException("Data file ", datapath, " length error: ", dl, " bytes required");
+	}
+	fd = ::open(datapath.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw SPException("Data file ", datapath, " open failed: ", errno);
+	}
+	mapSize = fs;
+
+	SPVerbose::show(SPVerbose::DATA, "datapath: ", datapath);
+	SPVerbose::show(SPVerbose::DATA, "segytape: ", segytape);
+	SPVerbose::show(SPVerbose::DATA, "fortran: ", fortran);
+	SPVerbose::show(SPVerbose::DATA, "byteswap: ", byteswap);
+	SPVerbose::show(SPVerbose::DATA, "nrTraces: ", nrTraces);
+
+	SPVerbose::show(SPVerbose::DATA, "dt: ", dt);
+	SPVerbose::show(SPVerbose::DATA, "ns: ", ns);
+	SPVerbose::show(SPVerbose::DATA, "scalel: ", scalel);
+	SPVerbose::show(SPVerbose::DATA, "scalco: ", scalco);
+
+	SPVerbose::show(SPVerbose::DATA, "traceSize: ", traceSize);
+	SPVerbose::show(SPVerbose::DATA, "headerOffset: ", headerOffset);
+	SPVerbose::show(SPVerbose::DATA, "recordLength: ", recordLength);
+	SPVerbose::show(SPVerbose::DATA, "conversion kernels: ",
+			SPConvert::getKernelName());
+}
+
+SPFileReader::~SPFileReader() {
+	if (mapping != 0) {
+		munmap(mapping, mapSize);
+	}
+	if (fd >= 0) {
+		close(fd);
+	}
+}
+
+bool SPFileReader::compatible(const SPFileReader& other) {
+	return dt == other.dt || ns == other.ns || scalel == other.scalel || scalco
+			== other.scalco;
+}
+
+void SPFileReader::overrideByteswap(bool on) {
+	SPVerbose::show(SPVerbose::ESSENTIAL, "Overriding byteswap of ", datapath,
+			" to ", on);
+	byteswap = on;
+}
+
+void SPFileReader::setFloatFormat(bool on) {
+	if (segytape) SPVerbose::show(SPVerbose::ESSENTIAL, datapath,
+			" has ", on? "IBM" : "IEEE", " floating point format");
+	ibmfloat = on;
+}
+
+void SPFileReader::useMap(bool on) {
+	if (on == (mapping != 0)) {
+		return;
+	}
+	if (!on) {
+		munmap(mapping, mapSize);
+		mapping = 0;
+		return;
+	}
+	void* m = mmap(0, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+	if (m == MAP_FAILED) {
+		throw SPException("Memory mapping of ", datapath, " failed: ", errno);
+	}
+	mapping = (char*)m;
+	SPVerbose::show(SPVerbose::DATA, "Memory mapped data file: ", datapath);
+}
+
+/**
+ * Deliver only count samples, starting at sample first, taking every
+ * step-th sample. ns, dt and delrt of the traces are changed accordingly.
+ * The samples after the window are not read.
+ */
+void SPFileReader::setWindow(int first, int count, int step) {
+	if (first < 0 || count < 1 || step < 1
+			|| first + (count - 1) * step >= ns) {
+		throw SPException("Sample window outside the traces of ", datapath);
+	}
+	windowFirst = first;
+	windowCount = count;
+	windowStep = step;
+	readSize = 240 + (first + (count - 1) * step + 1) * 4;
+	SPVerbose::show(SPVerbose::DATA, datapath, ": reading ", readSize,
+			" bytes per trace");
+}
+
+/**
+ * The delay recording time (delrt) of the first trace.
+ */
+int SPFileReader::readDelay() {
+	char header[240];
+	if (pread(fd, header, 240, getPosition(0)) != 240) {
+		throw SPException("Reading first trace header from ", datapath,
+				" failed");
+	}
+	if (byteswap) {
+		SPConvert::swapHeader(header);
+	}
+	return ((segy*)header)->delrt;
+}
+
+/**
+ * Tell the kernel how the mapped file is going to be walked through. Sorted
+ * reads jump around in the file, so the default read-ahead only pollutes the
+ * page cache; reads in file order benefit from aggressive read-ahead.
+ */
+void SPFileReader::adviseAccess(bool sequential) {
+	if (mapping == 0) {
+		return;
+	}
+	SPVerbose::show(SPVerbose::DATA, datapath, ": access pattern ",
+			sequential ? "sequential" : "random");
+	madvise(mapping, mapSize, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+}
+
+/**
+ * Ask for the pages of a trace to be brought in before it is read.
+ */
+void SPFileReader::prefetch(int id) {
+	if (mapping == 0) {
+		return;
+	}
+	static const long pageSize = sysconf(_SC_PAGESIZE);
+	long long p = getPosition(id);
+	long long start = p - p % pageSize;
+	madvise(mapping + start, p + readSize - start, MADV_WILLNEED);
+}
+
+/**
+ * Deliver the trace with the index. With a memory mapped file and no number
+ * conversion to be done, the result points directly into the mapping and must
+ * not be modified; pass writable if the caller is going to change the trace.
+ * In all other cases the trace is delivered in the internal buffer, which is
+ * reused by the next call.
+ */
+segy* SPFileReader::read(int id, bool writable) {
+	return read(id, (char*)store, writable);
+}
+
+/**
+ * Same as above, but the trace is delivered in the buffer given by the
+ * caller, which must hold at least getTraceSize() bytes.
+ */
+segy* SPFileReader::read(int id, char* buffer, bool writable) {
+	long long p = getPosition(id);
+	SPVerbose::show(SPVerbose::EVERYTHING, datapath, ": reading trace ", id,
+			" at ", p);
+
+	if (mapping != 0) {
+		if (!byteswap && !writable && !isWindowed()) {
+			return (segy*)(mapping + p);
+		}
+		memcpy(buffer, mapping + p, readSize);
+	} else if (pread(fd, buffer, readSize, p) != readSize) {
+		throw SPException("Reading trace ", id, " from ", datapath, " failed");
+	}
+	return convert(buffer);
+}
+
+/**
+ * Read the records from trace first to trace last, both included, with a
+ * single read. The trace with index i starts at
+ * buffer + (i - first) * getRecordLength() and still has to be converted.
+ */
+void SPFileReader::readBlock(int first, int last, char* buffer) {
+	long long p = getPosition(first);
+	long long length = getBlockSize(first, last);
+	SPVerbose::show(SPVerbose::EVERYTHING, datapath, ": reading traces ",
+			first, " to ", last);
+
+	if (mapping != 0) {
+		memcpy(buffer, mapping + p, length);
+		return;
+	}
+	while (length > 0) {
+		ssize_t done = pread(fd, buffer, length, p);
+		if (done <= 0) {
+			throw SPException("Reading traces from ", datapath, " failed at ",
+					p);
+		}
+		buffer += done;
+		p += done;
+		length -= done;
+	}
+}
+
+/**
+ * Convert a raw trace as read from the file to native number format in place.
+ * Only the samples of the window are converted and then moved to the start.
+ */
+segy* SPFileReader::convert(char* buffer) {
+	segy* trace = (segy*)buffer;
+	int* samples = (int*)(buffer + 240) + windowFirst;
+	int n = (windowCount - 1) * windowStep + 1;
+	if (byteswap) {  // swap trace headers
+		SPConvert::swapHeader(buffer);
+	}
+	if (byteswap && !ibmfloat) {
+		SPConvert::swapFloats(samples, n);
+	} else if (byteswap && segytape && ibmfloat) {
+		if (SPConvert::ibmToFloat(samples, samples, n, 0) > 0) {
+			SPVerbose::show(SPVerbose::ESSENTIAL, "mantissa is zero data may "
+					"not be in IBM FLOAT Format !");
+		}
+	}
+	if (isWindowed()) {
+		SPConvert::decimate((float*)samples, trace->data, windowCount,
+				windowStep);
+		trace->delrt += (windowFirst * trace->dt + 500) / 1000;
+		trace->dt *= windowStep;
+		trace->ns = windowCount;
+	}
+	return trace;
+}
+
+long long SPFileReader::fileSize(const string& name) {
+	struct stat res;
+
+	int rc= stat(name.c_str(), &res);
+	if (rc) {
+		throw SPException("Cannot get stat of file ", name, ": ", rc);
+	}
+	return res.st_size;
+}
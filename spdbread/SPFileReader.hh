@@ -0,0 +1,129 @@
+//============================================================================
+// Name        : SPFileReader.hh
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#ifndef SPFILEREADER_HH_
+#define SPFILEREADER_HH_
+
+#include <string>
+#include <SPProcessor.hh>
+
+using namespace std;
+
+namespace SP {
+
+/**
+ * Reader for the traces of one data file indexed by a database. It knows the
+ * layout of the file from the meta table of the database and delivers the
+ * traces in the native number format.
+ */
+class SPFileReader {
+public:
+	SPFileReader(const string& dbPath, const string& dataPath,
+			bool openData = true);
+	~SPFileReader();
+	bool compatible(const SPFileReader& other);
+	void overrideByteswap(bool on);
+	void setFloatFormat(bool on);
+	void useMap(bool on);
+	void adviseAccess(bool sequential);
+	void setWindow(int first, int count, int step);
+	int readDelay();
+	void prefetch(int id);
+
+	segy* read(int id, bool writable = false);
+	segy* read(int id, char* buffer, bool writable);
+	void readBlock(int first, int last, char* buffer);
+	segy* convert(char* trace);
+
+	int getDescriptor() {
+		return fd;
+	}
+
+	bool isMapped() {
+		return mapping != 0;
+	}
+
+	int getTraceSize() {
+		return traceSize;
+	}
+
+	/**
+	 * Number of bytes read of each trace, the header and the samples up to
+	 * the end of the sample window.
+	 */
+	int getReadSize() {
+		return readSize;
+	}
+
+	int getRecordLength() {
+		return recordLength;
+	}
+
+	int getNumberOfTraces() {
+		return nrTraces;
+	}
+
+	string getDataPath() {
+		return datapath;
+	}
+
+	int getNumberOfSamples() {
+		return ns;
+	}
+
+	bool isWindowed() {
+		return windowCount != ns || windowStep != 1;
+	}
+
+	int getSampleInterval() {
+		return dt;
+	}
+
+	/**
+	 * Number of bytes of a block read from trace first to trace last. Of the
+	 * last trace only the bytes up to the end of the sample window are read.
+	 */
+	long long getBlockSize(int first, int last) {
+		return ((long long)recordLength) * (last - first) + readSize;
+	}
+
+	long long getPosition(int id) {
+		return ((long long)recordLength) * id + headerOffset;
+	}
+
+private:
+	long long fileSize(const string& fileName);
+
+private:
+	int fd;
+	char* mapping;
+	long long mapSize;
+
+	string datapath;
+	bool segytape;
+	bool fortran;
+	bool byteswap;
+	bool ibmfloat;
+	int nrTraces;
+
+	int dt;
+	int ns;
+	int scalel;
+	int scalco;
+
+	int traceSize;
+	/** bytes read of each trace, traceSize without a window */
+	int readSize;
+	/** the samples delivered: count samples from first on, every step-th */
+	int windowFirst;
+	int windowCount;
+	int windowStep;
+	int headerOffset;
+	int recordLength;
+	segy* store;
+};
+}
+#endif /*SPFILEREADER_HH_*/
@@ -6,6 +6,8 @@
 //============================================================================
 #include "SPParsers.hh"
 #include <sstream>
+#include <set>
+#include <vector>
 #include <SPTable.hh>
 
 using namespace SP;
@@ -22,27 +24,23 @@ void SPParserBase::init(char* data, const char* separators) {
 	const char* ns = separators;
 	bool more = separators[1] != 0;
 
-	char* temp[1000];
+	vector<char*> temp;
 	char* d = data;
-	temp[0] = data;
-	length = 1;
+	temp.push_back(data);
 	while (*d != 0) {
 		if ( *ns == 0 || *d != *ns) {
 			++d;
 			continue;
 		}
 		*d = 0;
-		temp[length] = d + 1;
-		++length;
-		if (length > 999) {
-			throw SPException("Too many elements for ", separators);
-		}
+		temp.push_back(d + 1);
 		if (more) {
 			++ns;
 		}
 		++d;
 	}
 
+	length = temp.size();
 	fractions = new char*[length];
 	for (int i = 0; i < length; ++i) {
 		fractions[i] = temp[i];
@@ -104,43 +102,127 @@ void SPColumnSpec::collect(ostream& o) {
 	}
 }
 
-void SPColumnSpec::getPredicate(ostream& o) {
-	if (selection == 0) {
-		o << "1 = 1";
-		return;
-	}
+int SPColumnSpec::inListLimit = 256;
+int SPColumnSpec::tableLimit = 1000;
+
+/**
+ * Split the selection into the values, including the ranges with increment
+ * of up to inListLimit values, and the predicates of the other ranges, each
+ * starting with " OR ".
+ */
+void SPColumnSpec::collectValues(set<int>& values, ostream& ranges) {
 	SPRangeSpec** r = selection->getRanges();
 	int n = selection->getLength();
-	bool has = false;
 	for (int i = 0; i < n; ++i) {
-		if (has) {
-			o << " OR ";
-		} else {
-			has = true;
-		}
-		if (n > 1) {
-			o << "(";
+		if (!r[i]->hasLimits()) {
+			values.insert(r[i]->getValue());
+			continue;
 		}
-		o << name;
-		if (r[i]->hasLimits()) {
-			o << " between " << r[i]->getLowerLimit() << " AND "
-					<< r[i]->getUpperLimit();
-
-			if (r[i]->getMultiple() > 0) {
-				o << " AND (" << name << " - ((" << name << " - "
-						<< r[i]->getLowerLimit() << ")/" << r[i]->getMultiple()
-						<< ") * " << r[i]->getMultiple() << ") = "
-						<< r[i]->getLowerLimit();
+		int a = r[i]->getLowerLimit();
+		int b = r[i]->getUpperLimit();
+		int m = r[i]->getMultiple();
+		if (m > 1 && (b < a || ((long long)b - a) / m < inListLimit)) {
+			for (long long v = a; v <= b; v += m) {
+				values.insert(v);
 			}
-		} else {
-			o << " = " << r[i]->getValue();
+			continue;
 		}
-		if (n > 1) {
-			o << ")";
+		ranges << " OR (" << name << " between " << a << " AND " << b;
+		if (m > 1) {
+			ranges << " AND (" << name << " - " << a << ") % " << m << " = 0";
 		}
+		ranges << ")";
 	}
 }
 
+/**
+ * Load the values of the selection into the temporary table with the name
+ * if there are more than tableLimit of them. ::getPredicate then joins the
+ * table instead of listing the values.
+ */
+void SPColumnSpec::prepare(SPDB& db, const string& table) {
+	valueTable = "";
+	if (selection == 0) {
+		return;
+	}
+	set<int> values;
+	stringstream ranges;
+	collectValues(values, ranges);
+	if ((int)values.size() <= tableLimit) {
+		return;
+	}
+
+	stringstream ss;
+	ss << "drop table if exists temp." << table << ";";
+	db.executeStatement(ss, "");
+	ss.str("");
+	ss << "create temp table " << table << " (value integer primary key);";
+	db.executeStatement(ss, "create value table");
+	ss.str("");
+	ss << "insert into temp." << table << " values (?);";
+	sqlite3_stmt* statement = db.prepareStatement(ss, "value table inserts");
+	db.beginTransaction();
+	for (set<int>::iterator v = values.begin(); v != values.end(); ++v) {
+		sqlite3_bind_int(statement, 1, *v);
+		int rc = sqlite3_step(statement);
+		if (rc != SQLITE_DONE) {
+			throw SPException("value insertion failed: ", rc);
+		}
+		sqlite3_reset(statement);
+	}
+	db.commit();
+	sqlite3_finalize(statement);
+
+	valueTable = table;
+	SPVerbose::show(SPVerbose::ESSENTIAL, "Selecting ", (int)values.size(),
+			" values through table ", table);
+}
+
+/**
+ * The values and the ranges with increment of up to inListLimit values go
+ * into one IN list, or the value table of ::prepare, so an index on the
+ * column is searched for each value. Plain ranges and larger ranges with
+ * increment become range searches, the latter with a modulo filter on the
+ * range.
+ */
+void SPColumnSpec::getPredicate(ostream& o) {
+	if (selection == 0) {
+		o << "1 = 1";
+		return;
+	}
+	set<int> values;
+	stringstream ranges;
+	collectValues(values, ranges);
+
+	string rest = ranges.str();
+	if (values.empty() && rest.empty()) {
+		// only reversed ranges with increment, which select nothing
+		o << "0";
+		return;
+	}
+	if (values.empty()) {
+		// without the leading " OR "
+		o << rest.substr(4);
+		return;
+	}
+	o << name;
+	if (valueTable.length() > 0) {
+		o << " in temp." << valueTable;
+	} else if (values.size() == 1) {
+		o << " = " << *values.begin();
+	} else {
+		o << " in (";
+		for (set<int>::iterator v = values.begin(); v != values.end(); ++v) {
+			if (v != values.begin()) {
+				o << ", ";
+			}
+			o << *v;
+		}
+		o << ")";
+	}
+	o << rest;
+}
+
 void SPGroup::collect(ostream& o) {
 	for (int i = 0; i < getLength(); ++i) {
 		if (i > 0) {
@@ -150,6 +232,18 @@ void SPGroup::collect(ostream& o) {
 	}
 }
 
+/**
+ * Set up the value tables of the columns for the queries on the database,
+ * the names are unique for the group number.
+ */
+void SPGroup::prepare(SPDB& db, int number) {
+	for (int i = 0; i < getLength(); ++i) {
+		stringstream ss;
+		ss << "selection" << number << "_" << i;
+		columns[i]->prepare(db, ss.str());
+	}
+}
+
 string SPGroup::getWhere() {
 	stringstream ss;
 	int n = getLength();
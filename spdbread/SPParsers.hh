@@ -10,11 +10,14 @@
 #include <string>
 #include <iostream>
 #include <cstdlib>
+#include <set>
 
 using namespace std;
 
 namespace SP {
 
+class SPDB;
+
 template<typename T> T** buildSub(int length, char** texts) {
 	T** res = new T*[length];
 	for (int i = 0; i < length; ++i) {
@@ -170,9 +173,33 @@ public:
 	}
 
 	void collect(ostream& o);
+	void prepare(SPDB& db, const string& table);
 	void getPredicate(ostream& o);
 
+	/**
+	 * Ranges with increment of at most this number of values are selected
+	 * by an IN list, larger ones by a range and a modulo filter.
+	 */
+	static void setInListLimit(int limit) {
+		inListLimit = limit;
+	}
+
+	/**
+	 * Selections of more than this number of values are loaded into a
+	 * temporary table by ::prepare.
+	 */
+	static void setTableLimit(int limit) {
+		tableLimit = limit;
+	}
+
+private:
+	void collectValues(set<int>& values, ostream& ranges);
+
 private:
+	static int inListLimit;
+	static int tableLimit;
+
+	string valueTable;
 	char sort;
 	char* name;
 	SPValueSelection* selection;
@@ -194,6 +221,7 @@ public:
 	}
 
 	void collect(ostream& o);
+	void prepare(SPDB& db, int number);
 	string getWhere();
 	string getOrders();
 
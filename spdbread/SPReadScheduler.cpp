@@ -0,0 +1,328 @@
+//============================================================================
+// Name        : SPReadScheduler.cpp
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#include "SPReadScheduler.hh"
+#include <algorithm>
+#include <sys/stat.h>
+#include <string.h>
+
+using namespace std;
+using namespace SP;
+
+SPReadScheduler::SPReadScheduler(SPFileReader** files, int numberOfFiles,
+		int window) :
+	files(files), numberOfFiles(numberOfFiles),
+			window(window < 1 ? 1 : window), gap(-1), maxBlock(0), cache(0) {
+	slotSize = 0;
+	for (int i = 0; i < numberOfFiles; ++i) {
+		if (files[i]->getTraceSize() > slotSize) {
+			slotSize = files[i]->getTraceSize();
+		}
+		struct stat st;
+		long long dev = 0;
+		if (fstat(files[i]->getDescriptor(), &st) == 0) {
+			dev = st.st_dev;
+		}
+		unsigned int d = 0;
+		while (d < devices.size() && devices[d] != dev) {
+			++d;
+		}
+		if (d == devices.size()) {
+			devices.push_back(dev);
+		}
+		deviceOf.push_back(d);
+	}
+	buffer = new char[((long long)slotSize) * this->window];
+	requests.reserve(this->window);
+	order.reserve(this->window);
+	SPVerbose::show(SPVerbose::DATA, "Read scheduler window: ", this->window,
+			" traces, data files on ", (int)devices.size(), " device(s)");
+}
+
+SPReadScheduler::~SPReadScheduler() {
+	clear();
+	delete[] buffer;
+	for (unsigned int d = 0; d < engines.size(); ++d) {
+		delete engines[d];
+	}
+	delete cache;
+}
+
+/**
+ * Keep up to budget bytes of decoded traces, so traces requested again,
+ * e.g. by a later group, are not read and decoded again.
+ */
+void SPReadScheduler::setCache(long long budget) {
+	cache = new SPTraceCache(budget, slotSize);
+	SPVerbose::show(SPVerbose::DATA, "Trace cache for ", cache->getCapacity(),
+			" traces");
+}
+
+/**
+ * Let the block reads run in the background with up to depth reads in
+ * flight. The traces can be used as soon as their block has arrived while
+ * the rest of the window is still being read. With perDevice each device
+ * gets its own engine and depth, otherwise one engine serves all files.
+ */
+void SPReadScheduler::setAsync(int depth, bool useRing, bool perDevice) {
+	int n = perDevice ? devices.size() : 1;
+	if (!perDevice) {
+		deviceOf.assign(numberOfFiles, 0);
+	}
+	for (int d = 0; d < n; ++d) {
+		engines.push_back(SPAsyncReader::create(depth, useRing));
+	}
+	deviceRuns.resize(n);
+	nextRun.resize(n);
+	SPVerbose::show(SPVerbose::DATA, "Read queues: ", n);
+}
+
+/**
+ * Let traces close to each other in the same file be read with one read.
+ * Two requested traces are joined if at most gap traces lie between them and
+ * the joined read does not exceed maxBlock bytes. A negative gap switches
+ * joining off.
+ */
+void SPReadScheduler::setCoalescing(int gap, long long maxBlock) {
+	this->gap = gap;
+	this->maxBlock = maxBlock;
+	SPVerbose::show(SPVerbose::DATA, "Read coalescing gap: ", gap,
+			" traces, block limit: ", maxBlock, " bytes");
+}
+
+void SPReadScheduler::add(int fileid, int index) {
+	if (full()) {
+		throw SPException("Read scheduler window exceeded: ", window);
+	}
+	Request r;
+	r.fileid = fileid;
+	r.index = index;
+	r.trace = 0;
+	requests.push_back(r);
+}
+
+/**
+ * Read all requested traces in ascending file offset order per file. The
+ * traces stay valid until ::clear.
+ */
+void SPReadScheduler::fetch(bool writable) {
+	int n = size();
+	if (n == 0) {
+		return;
+	}
+	order.clear();
+	runOf.assign(n, -1);
+	if (cache != 0) {
+		lookup();
+	} else {
+		for (int k = 0; k < n; ++k) {
+			order.push_back(k);
+		}
+	}
+	if (order.empty()) {
+		return;
+	}
+	sort(order.begin(), order.end(), FileOrder(requests));
+
+	// mapped files gain nothing from joined reads
+	if (files[0]->isMapped()) {
+		fetchSingles(writable);
+		return;
+	}
+	planRuns();
+	if (engines.empty()) {
+		for (unsigned int r = 0; r < runDone.size(); ++r) {
+			Request& f = requests[order[runs[r]]];
+			files[f.fileid]->readBlock(f.index,
+					requests[order[runs[r + 1] - 1]].index,
+					&blocks[runOffsets[r]]);
+			completeRun(r);
+		}
+	} else {
+		for (unsigned int d = 0; d < engines.size(); ++d) {
+			deviceRuns[d].clear();
+			nextRun[d] = 0;
+		}
+		for (unsigned int r = 0; r < runDone.size(); ++r) {
+			deviceRuns[deviceOf[requests[order[runs[r]]].fileid]].push_back(r);
+		}
+		for (unsigned int d = 0; d < engines.size(); ++d) {
+			submitRuns(d);
+		}
+	}
+}
+
+/**
+ * The k-th trace in the order of the ::add calls. Valid until ::clear. With
+ * asynchronous reads this waits for the block holding the trace.
+ */
+segy* SPReadScheduler::get(int k) {
+	if (!engines.empty() && runOf[k] >= 0) {
+		waitRun(runOf[k]);
+	}
+	return requests[k].trace;
+}
+
+void SPReadScheduler::clear() {
+	// buffers may only be reused when no read is writing into them
+	for (unsigned int d = 0; d < engines.size(); ++d) {
+		while (engines[d]->getPending() > 0) {
+			engines[d]->wait();
+		}
+	}
+	requests.clear();
+}
+
+/**
+ * Wait on the engine of the run until it has arrived. Runs of the same
+ * device that finish meanwhile are completed on the way, and the reads the
+ * other devices have finished are collected without waiting, so their
+ * queues are refilled too.
+ */
+void SPReadScheduler::waitRun(int r) {
+	int d = deviceOf[requests[order[runs[r]]].fileid];
+	while (!runDone[r]) {
+		for (unsigned int e = 0; e < engines.size(); ++e) {
+			if ((int)e == d) {
+				continue;
+			}
+			for (int t = engines[e]->poll(); t >= 0; t = engines[e]->poll()) {
+				completeRun(t);
+			}
+			submitRuns(e);
+		}
+		completeRun(engines[d]->wait());
+		submitRuns(d);
+	}
+}
+
+/**
+ * Take the requested traces that are in the cache from there, the others
+ * are put in order to be read. A cached trace is copied to the slot of the
+ * request, so it stays valid while the cache changes.
+ */
+void SPReadScheduler::lookup() {
+	int n = size();
+	for (int k = 0; k < n; ++k) {
+		Request& r = requests[k];
+		const char* t = cache->find(r.fileid, r.index);
+		if (t == 0) {
+			order.push_back(k);
+			continue;
+		}
+		char* slot = buffer + ((long long)slotSize) * k;
+		memcpy(slot, t, slotSize);
+		r.trace = (segy*)slot;
+	}
+}
+
+/**
+ * Each request gets its own slot in the reorder buffer.
+ */
+void SPReadScheduler::fetchSingles(bool writable) {
+	int n = order.size();
+	for (int i = 0; i < n; ++i) {
+		Request& r = requests[order[i]];
+		files[r.fileid]->prefetch(r.index);
+	}
+	for (int i = 0; i < n; ++i) {
+		int k = order[i];
+		Request& r = requests[k];
+		r.trace = files[r.fileid]->read(r.index,
+				buffer + ((long long)slotSize) * k, writable);
+		if (cache != 0) {
+			// a mapped trace may end with the file, copy only what was read
+			cache->put(r.fileid, r.index, (const char*)r.trace,
+					files[r.fileid]->getBlockSize(r.index, r.index));
+		}
+	}
+}
+
+/**
+ * Split the sorted requests into runs that are read as one block each.
+ * Requests close to each other in a file go into the same run, the rest get
+ * a run of their own. A trace requested more than once is in the run only
+ * once.
+ */
+void SPReadScheduler::planRuns() {
+	int n = order.size();
+
+	runs.clear();
+	runOffsets.clear();
+	long long total = 0;
+	for (int i = 0; i < n;) {
+		Request& f = requests[order[i]];
+		SPFileReader* file = files[f.fileid];
+		int j = i + 1;
+		while (j < n) {
+			Request& r = requests[order[j]];
+			int last = requests[order[j - 1]].index;
+			if (r.fileid != f.fileid || r.index - last - 1 > gap
+					|| file->getBlockSize(f.index, r.index) > maxBlock) {
+				break;
+			}
+			++j;
+		}
+		for (int k = i; k < j; ++k) {
+			runOf[order[k]] = runs.size();
+		}
+		runs.push_back(i);
+		runOffsets.push_back(total);
+		total += file->getBlockSize(f.index, requests[order[j - 1]].index);
+		i = j;
+	}
+	runDone.assign(runs.size(), 0);
+	runs.push_back(n);
+	if ((long long)blocks.size() < total) {
+		blocks.resize(total);
+	}
+}
+
+/**
+ * Convert the traces of a block that has been read, in place inside the
+ * block.
+ */
+void SPReadScheduler::completeRun(int r) {
+	Request& f = requests[order[runs[r]]];
+	SPFileReader* file = files[f.fileid];
+	char* b = &blocks[runOffsets[r]];
+	segy* previous = 0;
+	for (int i = runs[r]; i < runs[r + 1]; ++i) {
+		Request& q = requests[order[i]];
+		if (i > runs[r] && q.index == requests[order[i - 1]].index) {
+			q.trace = previous;
+			continue;
+		}
+		q.trace = file->convert(b + ((long long)file->getRecordLength())
+				* (q.index - f.index));
+		previous = q.trace;
+		if (cache != 0) {
+			cache->put(q.fileid, q.index, (const char*)q.trace,
+					file->getBlockSize(q.index, q.index));
+		}
+	}
+	runDone[r] = 1;
+}
+
+/**
+ * Keep the engine of the device busy with its next blocks in file order.
+ */
+void SPReadScheduler::submitRuns(int device) {
+	SPAsyncReader* async = engines[device];
+	vector<int>& queue = deviceRuns[device];
+	int& next = nextRun[device];
+	while (next < (int)queue.size()
+			&& async->getPending() < async->getDepth()) {
+		int r = queue[next];
+		Request& f = requests[order[runs[r]]];
+		SPFileReader* file = files[f.fileid];
+		int last = requests[order[runs[r + 1] - 1]].index;
+		async->submit(file->getDescriptor(), &blocks[runOffsets[r]],
+				file->getBlockSize(f.index, last), file->getPosition(f.index),
+				r);
+		++next;
+	}
+}
@@ -0,0 +1,131 @@
+//============================================================================
+// Name        : SPReadScheduler.hh
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#ifndef SPREADSCHEDULER_HH_
+#define SPREADSCHEDULER_HH_
+
+#include <vector>
+#include "SPFileReader.hh"
+#include "SPAsyncReader.hh"
+#include "SPTraceCache.hh"
+
+using namespace std;
+
+namespace SP {
+
+/**
+ * Reads a window of traces in the order they are placed in the data files
+ * instead of the order they are requested in. The traces are requested with
+ * ::add in stream order, read in one go by ::fetch sorted by file and file
+ * offset, and then handed out in stream order again by ::get from the
+ * reorder buffer. This keeps the seek distance down when the selection is
+ * sorted differently from the data files.
+ *
+ * Asynchronous reads are queued per device the data files are stored on, so
+ * files on different disks are read at the same time, each disk in its own
+ * offset order.
+ */
+class SPReadScheduler {
+public:
+	SPReadScheduler(SPFileReader** files, int numberOfFiles, int window);
+	~SPReadScheduler();
+
+	void setCoalescing(int gap, long long maxBlock);
+	void setAsync(int depth, bool useRing, bool perDevice);
+	void setCache(long long budget);
+
+	SPTraceCache* getCache() {
+		return cache;
+	}
+
+	int getNumberOfDevices() {
+		return devices.size();
+	}
+
+	int getWindow() {
+		return window;
+	}
+
+	int size() {
+		return requests.size();
+	}
+
+	bool full() {
+		return size() >= window;
+	}
+
+	void add(int fileid, int index);
+	void fetch(bool writable);
+	segy* get(int k);
+	void clear();
+
+private:
+	void fetchSingles(bool writable);
+	void planRuns();
+	void completeRun(int r);
+	void submitRuns(int device);
+	void waitRun(int r);
+	void lookup();
+
+private:
+	struct Request {
+		int fileid;
+		int index;
+		segy* trace;
+	};
+
+	struct FileOrder {
+		vector<Request>& requests;
+		FileOrder(vector<Request>& r) :
+			requests(r) {
+		}
+		bool operator()(int a, int b) {
+			if (requests[a].fileid != requests[b].fileid) {
+				return requests[a].fileid < requests[b].fileid;
+			}
+			return requests[a].index < requests[b].index;
+		}
+	};
+
+private:
+	SPFileReader** files;
+	int numberOfFiles;
+	int window;
+	int slotSize;
+	char* buffer;
+	/** max number of unrequested traces read to join two reads */
+	int gap;
+	/** max size of a joined read in bytes */
+	long long maxBlock;
+	vector<char> blocks;
+	vector<Request> requests;
+	vector<int> order;
+
+	/** start of each run in order, plus the end of the last one */
+	vector<int> runs;
+	/** start of each run in blocks */
+	vector<long long> runOffsets;
+	/** the run each request is read with */
+	vector<int> runOf;
+	vector<char> runDone;
+
+	/** the device (index into devices) each file is stored on */
+	vector<int> deviceOf;
+	/** st_dev of each device */
+	vector<long long> devices;
+
+	/** one engine per device, or one for all */
+	vector<SPAsyncReader*> engines;
+	/** the runs of each device in submission order */
+	vector<vector<int> > deviceRuns;
+	/** the next entry of deviceRuns to be submitted */
+	vector<int> nextRun;
+
+	/** decoded traces kept across windows and groups, or 0 */
+	SPTraceCache* cache;
+};
+}
+#endif /*SPREADSCHEDULER_HH_*/
@@ -0,0 +1,93 @@
+//============================================================================
+// Name        : SPTraceCache.cpp
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#include "SPTraceCache.hh"
+#include <string.h>
+
+using namespace std;
+using namespace SP;
+
+SPTraceCache::SPTraceCache(long long budget, int traceSize) :
+	traceSize(traceSize), head(-1), tail(-1), used(0), hits(0), misses(0) {
+	long long n = budget / traceSize;
+	capacity = n > 0x7fffffff ? 0x7fffffff : (n < 1 ? 1 : n);
+	data = new char[((long long)capacity) * traceSize];
+	keys.resize(capacity);
+	next.resize(capacity);
+	previous.resize(capacity);
+	slots.reserve(capacity);
+}
+
+SPTraceCache::~SPTraceCache() {
+	delete[] data;
+}
+
+/**
+ * The cached trace, valid until the next ::put, or 0.
+ */
+const char* SPTraceCache::find(int fileid, int index) {
+	unordered_map<long long, int>::iterator i = slots.find(key(fileid, index));
+	if (i == slots.end()) {
+		++misses;
+		return 0;
+	}
+	++hits;
+	int s = i->second;
+	if (s != head) {
+		unlink(s);
+		pushFront(s);
+	}
+	return data + ((long long)s) * traceSize;
+}
+
+/**
+ * Keep a copy of the first size bytes of the trace, at most the trace size
+ * of the cache, replacing the least recently used one if the cache is full.
+ */
+void SPTraceCache::put(int fileid, int index, const char* trace, int size) {
+	long long k = key(fileid, index);
+	if (slots.count(k) > 0) {
+		return;
+	}
+	int s;
+	if (used < capacity) {
+		s = used++;
+	} else {
+		s = tail;
+		unlink(s);
+		slots.erase(keys[s]);
+	}
+	memcpy(data + ((long long)s) * traceSize, trace,
+			size < traceSize ? size : traceSize);
+	keys[s] = k;
+	slots[k] = s;
+	pushFront(s);
+}
+
+void SPTraceCache::unlink(int slot) {
+	if (previous[slot] >= 0) {
+		next[previous[slot]] = next[slot];
+	} else {
+		head = next[slot];
+	}
+	if (next[slot] >= 0) {
+		previous[next[slot]] = previous[slot];
+	} else {
+		tail = previous[slot];
+	}
+}
+
+void SPTraceCache::pushFront(int slot) {
+	previous[slot] = -1;
+	next[slot] = head;
+	if (head >= 0) {
+		previous[head] = slot;
+	}
+	head = slot;
+	if (tail < 0) {
+		tail = slot;
+	}
+}
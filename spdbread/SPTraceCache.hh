@@ -0,0 +1,68 @@
+//============================================================================
+// Name        : SPTraceCache.hh
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#ifndef SPTRACECACHE_HH_
+#define SPTRACECACHE_HH_
+
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+namespace SP {
+
+/**
+ * Decoded traces of the data files, keyed by file and trace number, in a
+ * fixed number of slots. When all slots are taken the least recently used
+ * trace is replaced.
+ */
+class SPTraceCache {
+public:
+	SPTraceCache(long long budget, int traceSize);
+	~SPTraceCache();
+
+	int getCapacity() {
+		return capacity;
+	}
+
+	long long getHits() {
+		return hits;
+	}
+
+	long long getMisses() {
+		return misses;
+	}
+
+	const char* find(int fileid, int index);
+	void put(int fileid, int index, const char* trace, int size);
+
+private:
+	static long long key(int fileid, int index) {
+		return (((long long)fileid) << 32) | (unsigned int)index;
+	}
+
+	void unlink(int slot);
+	void pushFront(int slot);
+
+private:
+	int traceSize;
+	int capacity;
+	char* data;
+	/** key of the trace in each slot */
+	vector<long long> keys;
+	/** doubly linked list of the slots, most recently used first */
+	vector<int> next;
+	vector<int> previous;
+	int head;
+	int tail;
+	int used;
+	unordered_map<long long, int> slots;
+
+	long long hits;
+	long long misses;
+};
+}
+#endif /*SPTRACECACHE_HH_*/
@@ -7,243 +7,99 @@
 
 #define _FILE_OFFSET_BITS 64
 
-#include <sys/stat.h>
-#include <fstream>
 #include <sstream>
+#include <fstream>
 #include <set>
+#include <algorithm>
+#include <cmath>
+#include <thread>
 #include <SPProcessor.hh>
 #include <SPAccessors.hh>
+#include <header.h>
 #include "SPParsers.hh"
+#include "SPFileReader.hh"
+#include "SPReadScheduler.hh"
+#include "SPCostEstimator.hh"
 #include <SPTable.hh>
-#include <header.h>
+#include <SPPermutation.hh>
 
 using namespace std;
 using namespace SP;
 
 #undef open
 
-bool bigEndianMachine() {
-	long l = 0;
-	char *b = (char *)&l;
-	b[3] = 1;
-	return l == 1;
-}
-
-class filereader {
-public:
-	filereader(const string& dbPath, const string& dataPath);
-	~filereader() {
-	}
-	bool compatible(const filereader& other);
-	void overrideByteswap(bool on);
-	void setFloatFormat(bool on);
-	void ibm_to_float(int from[], int to[], int n, int endian);
-
-	segy* read(int id);
-
-private:
-	long long fileSize(const string& fileName);
-
-private:
-	ifstream file;
-
-	string datapath;
-	bool segytape;
-	bool fortran;
-	bool byteswap;
-	bool ibmfloat;
-	int nrTraces;
-
-	int dt;
-	int ns;
-	int scalel;
-	int scalco;
-
-	int traceSize;
-	int headerOffset;
-	int recordLength;
-	segy* store;
-};
-
-filereader::filereader(const string& dbPath, const string& dataPath) {
-	SPVerbose::show(SPVerbose::DATA, "Initializing for db: ", dbPath);
-
-	if (!fileSize(dbPath)) {
-		throw SPException("File for database not found: ", dbPath);
-	}
-
-	map<string, string>& meta = (new SPKVTable())->read(dbPath, "meta");
-
-	datapath = dataPath == "" ? meta["datapath"] : dataPath;
-	segytape = meta["segytape"] == "true";
-	fortran = meta["fortran"] == "true";
-
-	byteswap = segytape != bigEndianMachine();
-	ibmfloat = true;
-
-	dt = atoi(meta["dt"].c_str());
-	ns = atoi(meta["ns"].c_str());
-	scalel = atoi(meta["scalel"].c_str());
-	scalco = atoi(meta["scalco"].c_str());
-	nrTraces = atoi(meta["numberoftraces"].c_str());
-
-	traceSize = 240 + ns * 4;
-	recordLength = traceSize;
-	headerOffset = 0;
-	if (fortran) {
-		recordLength += 8;
-		headerOffset += 4;
-	}
-	if (segytape) {
-		headerOffset += 3600;
-		if (fortran) {
-			headerOffset += 16;
-		}
-	}
-	store = (segy*)new char[traceSize];
-
-	long long fs = fileSize(datapath);
-	long long dl = ((long long)recordLength) * nrTraces + headerOffset - 4;
-	if (fs < dl) {
-		throw SPException("Data file ", datapath, " length error: ", dl, " bytes required");
-	}
-	file.open(datapath.c_str(), ios::in | ios::binary);
-
-	SPVerbose::show(SPVerbose::DATA, "datapath: ", datapath);
-	SPVerbose::show(SPVerbose::DATA, "segytape: ", segytape);
-	SPVerbose::show(SPVerbose::DATA, "fortran: ", fortran);
-	SPVerbose::show(SPVerbose::DATA, "byteswap: ", byteswap);
-	SPVerbose::show(SPVerbose::DATA, "nrTraces: ", nrTraces);
-
-	SPVerbose::show(SPVerbose::DATA, "dt: ", dt);
-	SPVerbose::show(SPVerbose::DATA, "ns: ", ns);
-	SPVerbose::show(SPVerbose::DATA, "scalel: ", scalel);
-	SPVerbose::show(SPVerbose::DATA, "scalco: ", scalco);
-
-	SPVerbose::show(SPVerbose::DATA, "traceSize: ", traceSize);
-	SPVerbose::show(SPVerbose::DATA, "headerOffset: ", headerOffset);
-	SPVerbose::show(SPVerbose::DATA, "recordLength: ", recordLength);
-}
-
-bool filereader::compatible(const filereader& other) {
-	return dt == other.dt || ns == other.ns || scalel == other.scalel || scalco
-			== other.scalco;
-}
-
-void filereader::overrideByteswap(bool on) {
-	SPVerbose::show(SPVerbose::ESSENTIAL, "Overriding byteswap of ", datapath,
-			" to ", on);
-	byteswap = on;
-}
-
-void filereader::setFloatFormat(bool on) {
-	if (segytape) SPVerbose::show(SPVerbose::ESSENTIAL, datapath,
-			" has ", on? "IBM" : "IEEE", " floating point format");
-	ibmfloat = on;
-}
-
-segy* filereader::read(int id) {
-	long long p = ((long long)recordLength) * id + headerOffset;
-	SPVerbose::show(SPVerbose::EVERYTHING, datapath, ": reading trace ", id,
-			" at ", p);
-
-	file.seekg(p);
-	file.read((char*)store, traceSize);
-
-	if (byteswap) {  // swap trace headers
-		for (int i = 0; i < SU_NKEYS; ++i) {
-			swaphval(store, i);
-		}
-	}
-	if (byteswap && !ibmfloat) {
-		for (int i = 0; i < ns; ++i) {
-			swap_float_4((float*)((char*)store + (240 + i * 4)));
-		}
-	} else if (byteswap && segytape && ibmfloat) {
-	    ibm_to_float((int *) ((char*)store + 240), (int *) ((char*)store + 240), ns, 0);
-	}
-	return store;
-}
-
-long long filereader::fileSize(const string& name) {
-	struct stat res;
-
-	int rc= stat(name.c_str(), &res);
-	if (rc) {
-		throw SPException("Cannot get stat of file ", name, ": ", rc);
-	}
-	return res.st_size;
-}
-
-void filereader::ibm_to_float(int from[], int to[], int n, int endian)
-/***********************************************************************
-ibm_to_float - convert between 32 bit IBM and IEEE floating numbers
- ************************************************************************
-Input::
-from		input vector
-to		output vector, can be same as input vector
-endian		byte order =0 little endian (DEC, PC's)
-                            =1 other systems
- *************************************************************************
-Notes:
-Up to 3 bits lost on IEEE -> IBM
-
-Assumes sizeof(int) == 4
-
-IBM -> IEEE may overflow or underflow, taken care of by
-substituting large number or zero
-
-Only integer shifting and masking are used.
- *************************************************************************
-Credits: CWP: Brian Sumner,  c.1985
- *************************************************************************/
-{
-    int fconv, fmant, i, t;
-
-    for (i = 0; i < n; ++i) {
-
-        fconv = from[i];
-
-        /* if little endian, i.e. endian=0 do this */
-        if (endian == 0) fconv = (fconv << 24) | ((fconv >> 24) & 0xff) |
-            ((fconv & 0xff00) << 8) | ((fconv & 0xff0000) >> 8);
-
-        if (fconv) {
-            fmant = 0x00ffffff & fconv;
-            /* The next two lines were added by Toralf Foerster */
-            /* to trap non-IBM format data i.e. conv=0 data  */
-            if (fmant == 0)
-                SPVerbose::show(SPVerbose::ESSENTIAL, "mantissa is zero data may not be in IBM FLOAT Format !");
-            t = (int) ((0x7f000000 & fconv) >> 22) - 130;
-            while (!(fmant & 0x00800000)) {
-                --t;
-                fmant <<= 1;
-            }
-            if (t > 254) fconv = (0x80000000 & fconv) | 0x7f7fffff;
-            else if (t <= 0) fconv = 0;
-            else fconv = (0x80000000 & fconv) | (t << 23)
-                | (0x007fffff & fmant);
-        }
-        to[i] = fconv;
-    }
-    return;
-}
-
-
 class spdbread : public SPProcessor {
 public:
 	void init();
 
 private:
-	stringstream& getSQL(SPDB& db, SPGroup* group);
+	string getSQL(SPDB& db, SPGroup* group, const string& fields,
+			const string& where, bool sorted = true);
+	void openQuery(SPDB& db, SPGroup* group, SPTable& target);
+	void openQuery(SPDB& db, SPGroup* group, SPTable& target,
+			const string& fields, const string& where);
+	bool fromPermutation(int j);
+	int combinedEnd(int j);
+	void readCombined(SPDB& db, int first, int end, int batch);
+	int nextQueryGroup(int j);
+	void startPrefetch(int j, int batch);
+	void prefetchGroup(int j, int batch);
+	bool takePrefetched(int j);
+	string getFields(SPGroup** groups, int count = 1);
+	vector<SPSortKey> getSortKeys(SPGroup* group);
+	bool getPermutationOrder(SPGroup* group, vector<SPSortKey>& order);
+	bool readPermutation(SPGroup* group, int batch, long long& n);
+	string addSelectFiles(const string& selection, const string& spec);
+	void showPlan(SPDB& db, const string& sql);
+	bool needsIndex(SPDB& db, const string& sql);
+	string getIndexColumns(SPGroup* group);
 	bool checkData();
+	bool setSampleWindow();
+	void adviseAccess();
+	SPCopyMachine* buildCopyMachine();
+	void writeRows(SPCopyMachine* copy);
+	void writeHeaders(SPCopyMachine* copy);
+	void prepareHeaders(SPDB& db);
 
 private:
 	SPTable table;
 	SPParserBase* overrides;
 	SPIndexFileSpec* fileSpec;
-	filereader** files;
+	SPFileReader** files;
+	SPReadScheduler* scheduler;
 	SPSelection* select;
+	bool mapped;
+	/** sort the rows of a group in memory instead of by SQLite */
+	bool memsort;
+	/** set for dryrun=1, which only counts the traces to be read */
+	SPCostEstimator* estimator;
+
+	/** the most groups read with one query, each has a bit in groupmask */
+	static const int MAX_COMBINED = 30;
+
+	/**
+	 * With overlap=1 the query of the next group is opened and its first
+	 * batch read into next by a thread of its own while the traces of the
+	 * current group are written. The thread gets the background connection
+	 * the query of table is not open on, so it never shares one with it.
+	 */
+	SPDB* background[2];
+	SPTable next;
+	thread* prefetch;
+	/** the connections of the queries of table and next, 0 for the main one */
+	SPDB* tableDB;
+	SPDB* nextDB;
+	/** the group in next, and the error of the thread if it failed */
+	int prefetched;
+	string prefetchError;
+
+	/** where the traces come from: data files, or headers in the db */
+	enum {
+		TRACES, HEADERS, ZERO_SAMPLES
+	} headerMode;
+	/** header lookup in the traceheaders table of each db */
+	vector<sqlite3_stmt*> headerReads;
+	segy headerTrace;
 };
 
 void spdbread::init() {
@@ -275,17 +131,24 @@ void spdbread::init() {
 				getStringParameter("overrides"));
 	}
 
+	SPColumnSpec::setInListLimit(getIntParameter("inlist", 256));
+	SPColumnSpec::setTableLimit(getIntParameter("valuetable", 1000));
+
+	string s;
 	if (hasParameter("select")) {
-		string s = getStringParameter("select");
-		select = new SPSelection(s);
+		s = getStringParameter("select");
 		SPVerbose::show(SPVerbose::ESSENTIAL, "Parameter found: select=", s);
 	} else {
-		select = new SPSelection((char*)"");
 		SPVerbose::show(SPVerbose::ESSENTIAL, "Selection not specified");
 	}
+	if (hasParameter("selectfile")) {
+		string f = getStringParameter("selectfile");
+		SPVerbose::show(SPVerbose::ESSENTIAL, "Parameter found: selectfile=",
+				f);
+		s = addSelectFiles(s, f);
+	}
+	select = new SPSelection(s);
 	
-	SPCopyMachine* copy = 0;
-
 	SPVerbose::show(SPVerbose::ESSENTIAL,
 			"Openning data base connection for selected read");
 	vector<string> names;
@@ -295,48 +158,254 @@ void spdbread::init() {
 		SPVerbose::show(SPVerbose::DATA, "Adding database file: ", n);
 	}
 	SPDB db(names);
+	background[0] = background[1] = 0;
+	prefetch = 0;
+	prefetched = -1;
+	tableDB = nextDB = 0;
+	memsort = getBooleanParameter("memsort", false);
+	// the thread creates indexes for autoindex=1 in the middle of the reads
+	// of the current group, and memsort=1 reads each group all at once
+	if (select->getLength() > 1 && getBooleanParameter("overlap", true)
+			&& !memsort && !getBooleanParameter("autoindex", false)
+			&& sqlite3_threadsafe()) {
+		background[0] = new SPDB(names);
+		background[1] = new SPDB(names);
+	}
+	if (headerMode != TRACES) {
+		prepareHeaders(db);
+	}
 
 	SPSegy::getPicker()["indexnumber"] = new SPPicker<int>(0);
 	SPSegy::getPicker()["fileid"] = new SPPicker<int>(0);
+	SPSegy::getPicker()["groupmask"] = new SPPicker<int>(0);
+	estimator = 0;
+	if (getBooleanParameter("dryrun", false)) {
+		estimator = new SPCostEstimator(files, fileSpec->getLength(),
+				headerMode == TRACES);
+	}
+	int threads = getIntParameter("sortthreads", thread::hardware_concurrency());
+	// the rows of a group can only be sorted all at once
+	int batch = memsort ? -1 : getIntParameter("batch", 65536);
 	for (int j = 0; j < select->getLength(); ++j) {
 		table.clean();
-		SPVerbose::show(SPVerbose::ESSENTIAL,
-				"Reading data from database for group #", j);
-		table.readBySQL(db, getSQL(db, select->getGroups()[j]), SPSegy::getPicker());
-
-		if (overrides != 0 && overrides->getLength() > 0 && copy == 0) {
-			SPVerbose::show(SPVerbose::ESSENTIAL,
-					"Building copy machine for header overrides");
-			copy = new SPCopyMachine();
-			for (int i = 0; i < overrides->getLength(); ++i) {
-				string f = overrides->getFractions()[i];
-				copy->addCopy(*table.getColumnPicker(f), *SPSegy::getPicker()[f]);
+		tableDB = 0;
+		long long n = 0;
+		if (estimator != 0) {
+			estimator->reset();
+		}
+		if (readPermutation(select->getGroups()[j], batch, n)) {
+			SPVerbose::show(SPVerbose::ESSENTIAL, "End of group #", j,
+					", number of records written: ", n);
+			if (estimator != 0) {
+				estimator->report(cerr, j);
 			}
+			continue;
+		}
+		int end = combinedEnd(j);
+		if (end > j + 1) {
+			readCombined(db, j, end, batch);
+			j = end - 1;
+			continue;
+		}
+		bool ready = takePrefetched(j);
+		if (!ready) {
+			SPVerbose::show(SPVerbose::ESSENTIAL,
+					"Reading data from database for group #", j);
+			select->getGroups()[j]->prepare(db, j);
+			openQuery(db, select->getGroups()[j], table);
+		}
+		SPCopyMachine* copy = buildCopyMachine();
+		int k = background[0] != 0 ? nextQueryGroup(j) : -1;
+		if (k > 0 && combinedEnd(k) == k + 1) {
+			startPrefetch(k, batch);
 		}
 
 		SPVerbose::show(SPVerbose::ESSENTIAL,
 				"Reading selected data from trace files");
-		int n = table.numberOfRows();
-		for (int i = 0; i < n; ++i) {
-			void* row = table.getRowStart(i);
-			int fid = table.getColumnPicker("fileid")->getInt(row);
-			int index = table.getColumnPicker("indexnumber")->getInt(row);
-			segy* s = files[fid]->read(index);
-			if (copy != 0) {
-				copy->run(row, (void*)s);
+		int max = batch > 0 ? batch : -1;
+		for (int rows = ready ? table.numberOfRows() : table.fetchRows(max);
+				rows > 0; rows = table.fetchRows(max)) {
+			if (memsort) {
+				vector<SPSortKey> order = getSortKeys(select->getGroups()[j]);
+				table.sortRows(order, threads);
+			}
+			if (mapped && n == 0) {
+				adviseAccess();
 			}
-			fputtr(stdout, s);
+			n += table.numberOfRows();
+			writeRows(copy);
 		}
+		delete copy;
 		SPVerbose::show(SPVerbose::ESSENTIAL, "End of group #", j,
 				", number of records written: ", n);
+		if (estimator != 0) {
+			estimator->report(cerr, j);
+		}
+	}
+
+	if (prefetch != 0) {
+		prefetch->join();
+		delete prefetch;
+		prefetch = 0;
+	}
+	next.clean();
+	delete background[0];
+	delete background[1];
+
+	for (unsigned int i = 0; i < headerReads.size(); ++i) {
+		sqlite3_finalize(headerReads[i]);
+	}
+	headerReads.clear();
+
+	SPTraceCache* cache = scheduler->getCache();
+	if (cache != 0) {
+		cerr << "Trace cache hits: " << cache->getHits() << ", misses: "
+				<< cache->getMisses() << endl;
+	}
+}
+
+/**
+ * The copy machine for the header overrides from the columns of the current
+ * query, or 0 if there are no overrides. The column layout of the table
+ * differs between groups, so it is built for each of them.
+ */
+SPCopyMachine* spdbread::buildCopyMachine() {
+	if (overrides == 0 || overrides->getLength() == 0) {
+		return 0;
+	}
+	SPVerbose::show(SPVerbose::DATA,
+			"Building copy machine for header overrides");
+	SPCopyMachine* copy = new SPCopyMachine();
+	for (int i = 0; i < overrides->getLength(); ++i) {
+		string f = overrides->getFractions()[i];
+		copy->addCopy(*table.getColumnPicker(f), *SPSegy::getPicker()[f]);
+	}
+	return copy;
+}
+
+/**
+ * Read and write out the traces of the rows in the table, a scheduler window
+ * at a time.
+ */
+void spdbread::writeRows(SPCopyMachine* copy) {
+	int n = table.numberOfRows();
+	SPAbstractPicker* fileid = table.getColumnPicker("fileid");
+	SPAbstractPicker* indexnumber = table.getColumnPicker("indexnumber");
+	if (estimator != 0) {
+		for (int k = 0; k < n; ++k) {
+			void* row = table.getRowStart(k);
+			estimator->add(fileid->getInt(row), indexnumber->getInt(row));
+		}
+		return;
+	}
+	if (headerMode != TRACES) {
+		writeHeaders(copy);
+		return;
+	}
+	for (int i = 0; i < n; i += scheduler->size()) {
+		scheduler->clear();
+		for (int k = i; k < n && !scheduler->full(); ++k) {
+			void* row = table.getRowStart(k);
+			scheduler->add(fileid->getInt(row), indexnumber->getInt(row));
+		}
+		scheduler->fetch(copy != 0);
+		for (int k = 0; k < scheduler->size(); ++k) {
+			segy* s = scheduler->get(k);
+			if (copy != 0) {
+				copy->run(table.getRowStart(i + k), (void*)s);
+			}
+			writeTrace(s);
+		}
+	}
+}
+
+void spdbread::prepareHeaders(SPDB& db) {
+	for (int i = 0; i < db.getNumberOfFiles(); ++i) {
+		stringstream ss;
+		ss << "select header from ";
+		if (db.getNumberOfFiles() > 1) {
+			ss << "db" << i << ".";
+		}
+		ss << "traceheaders where indexnumber = ?;";
+		headerReads.push_back(db.prepareStatement(ss,
+				"trace header select (spdbwrite traceheaders=1)"));
+	}
+}
+
+/**
+ * Write the traces of the rows in the table with the headers stored in the
+ * databases, without samples or with zero samples. The data files are not
+ * read.
+ */
+void spdbread::writeHeaders(SPCopyMachine* copy) {
+	int n = table.numberOfRows();
+	SPAbstractPicker* fileid = table.getColumnPicker("fileid");
+	SPAbstractPicker* indexnumber = table.getColumnPicker("indexnumber");
+	for (int k = 0; k < n; ++k) {
+		void* row = table.getRowStart(k);
+		int fid = fileid->getInt(row);
+		int index = indexnumber->getInt(row);
+		sqlite3_stmt* s = headerReads[fid];
+		sqlite3_bind_int(s, 1, index);
+		if (sqlite3_step(s) != SQLITE_ROW
+				|| sqlite3_column_bytes(s, 0) != HDRBYTES) {
+			throw SPException("No trace header in the database for trace ",
+					index);
+		}
+		memcpy(&headerTrace, sqlite3_column_blob(s, 0), HDRBYTES);
+		sqlite3_reset(s);
+
+		if (copy != 0) {
+			copy->run(row, (void*)&headerTrace);
+		}
+		if (headerMode == HEADERS) {
+			headerTrace.ns = 0;
+		} else {
+			memset(headerTrace.data, 0, headerTrace.ns * sizeof(float));
+		}
+		writeTrace(&headerTrace);
+	}
+}
+
+/**
+ * Set the mapping hints for each file according to the order its traces are
+ * requested by the current group: mostly ascending trace numbers are read
+ * sequentially, everything else is random access.
+ */
+void spdbread::adviseAccess() {
+	int l = fileSpec->getLength();
+	vector<int> last(l, -1);
+	vector<int> ascending(l, 0);
+	vector<int> total(l, 0);
+	SPAbstractPicker* fileid = table.getColumnPicker("fileid");
+	SPAbstractPicker* indexnumber = table.getColumnPicker("indexnumber");
+	for (int i = 0; i < table.numberOfRows(); ++i) {
+		void* row = table.getRowStart(i);
+		int fid = fileid->getInt(row);
+		int index = indexnumber->getInt(row);
+		if (index > last[fid]) {
+			++ascending[fid];
+		}
+		++total[fid];
+		last[fid] = index;
+	}
+	for (int i = 0; i < l; ++i) {
+		if (total[i] > 0) {
+			files[i]->adviseAccess(ascending[i] * 10 >= total[i] * 9);
+		}
 	}
 }
 
 bool spdbread::checkData() {
-	files = new filereader*[fileSpec->getLength()];
+	headerMode = getBooleanParameter("headeronly", false) ? HEADERS
+			: getBooleanParameter("zerosamples", false) ? ZERO_SAMPLES : TRACES;
+	mapped = getBooleanParameter("mmap", false) && headerMode == TRACES;
+	files = new SPFileReader*[fileSpec->getLength()];
 	for (int i = 0; i < fileSpec->getLength(); ++i) {
 		SPDBFilePath* f = fileSpec->getFiles()[i];
-		files[i] = new filereader(f->getDBFileName(), f->getDataFileName());
+		files[i] = new SPFileReader(f->getDBFileName(), f->getDataFileName(),
+				headerMode == TRACES);
+		files[i]->useMap(mapped);
 		if (hasParameter("byteswap")) {
 			files[i]->overrideByteswap(getBooleanParameter("byteswap", false));
 		}
@@ -349,17 +418,496 @@ bool spdbread::checkData() {
 			}
 		}
 	}
+	bool windowed = setSampleWindow();
+	scheduler = new SPReadScheduler(files, fileSpec->getLength(),
+			getIntParameter("window", 128));
+	// joined reads would read the samples outside the window
+	scheduler->setCoalescing(getIntParameter("gap", windowed ? -1 : 2),
+			getIntParameter("maxblock", 4096) * 1024LL);
+	if (getIntParameter("cache", 0) > 0) {
+		scheduler->setCache(getIntParameter("cache", 0) * 1048576LL);
+	}
+	int depth = getIntParameter("depth", 4);
+	if (depth > 0 && !mapped && headerMode == TRACES) {
+		scheduler->setAsync(depth, getBooleanParameter("uring", true),
+				getBooleanParameter("perdevice", true));
+	}
 	return true;
 }
 
-stringstream& spdbread::getSQL(SPDB& db, SPGroup *group) {
+/**
+ * Open the query of the group on the table. With several database files and
+ * merge=1 each file is queried in the sort order of the group on its own,
+ * and the sorted results are merged.
+ */
+void spdbread::openQuery(SPDB& db, SPGroup* group, SPTable& target) {
+	openQuery(db, group, target, getFields(&group), group->getWhere());
+}
+
+/**
+ * Same as above with the result columns and the condition given, the rows
+ * are sorted in the order of the group.
+ */
+void spdbread::openQuery(SPDB& db, SPGroup* group, SPTable& target,
+		const string& fields, const string& where) {
+	vector<string> sql;
+	for (int i = 0; i < db.getNumberOfFiles(); ++i) {
+		sql.push_back(db.getSelect(i, "headers", fields, where, "fileid")
+				+ " order by " + group->getOrders() + " indexnumber;");
+	}
+
+	if (getBooleanParameter("autoindex", false)) {
+		string columns = getIndexColumns(group);
+		for (unsigned int i = 0; i < sql.size(); ++i) {
+			if (columns.length() > 0 && needsIndex(db, sql[i])) {
+				try {
+					db.createIndex(i, "headers", columns);
+				} catch (SPException e) {
+					SPVerbose::show(SPVerbose::ERROR, "No index created: ",
+							e.what());
+				}
+			}
+		}
+	}
+
+	if (db.getNumberOfFiles() == 1 || !getBooleanParameter("merge", true)
+			|| memsort) {
+		stringstream ss(getSQL(db, group, fields, where, !memsort));
+		if (getBooleanParameter("explain", false)) {
+			showPlan(db, ss.str());
+		}
+		target.openSQL(db, ss, SPSegy::getPicker());
+		return;
+	}
+
+	vector<SPSortKey> order = getSortKeys(group);
+	if (getBooleanParameter("explain", false)) {
+		for (unsigned int i = 0; i < sql.size(); ++i) {
+			showPlan(db, sql[i]);
+		}
+	}
+	target.openSQL(db, sql, SPSegy::getPicker(), order);
+}
+
+/**
+ * Whether group j is read from a permutation file rather than by a query.
+ */
+bool spdbread::fromPermutation(int j) {
+	vector<SPSortKey> order;
+	return getPermutationOrder(select->getGroups()[j], order)
+			&& SPPermutation::isCurrent(
+					fileSpec->getFiles()[0]->getDBFileName(), order);
+}
+
+/**
+ * The first group after j that is read by a query rather than from a
+ * permutation file, or -1 if there is none.
+ */
+int spdbread::nextQueryGroup(int j) {
+	for (int k = j + 1; k < select->getLength(); ++k) {
+		if (!fromPermutation(k)) {
+			return k;
+		}
+	}
+	return -1;
+}
+
+/**
+ * The end of the groups from j on that are read with a single query: they
+ * follow each other, are not read from a permutation file, sort in the
+ * same order and have a condition. j + 1 if group j is read on its own.
+ * A group selecting all traces would keep the whole table in memory, so it
+ * is read in batches on its own.
+ */
+int spdbread::combinedEnd(int j) {
+	SPGroup** groups = select->getGroups();
+	if (!getBooleanParameter("combine", true) || memsort
+			|| getBooleanParameter("autoindex", false)
+			|| groups[j]->getWhere().length() == 0) {
+		return j + 1;
+	}
+	string orders = groups[j]->getOrders();
+	int end = j + 1;
+	while (end < select->getLength() && end - j < MAX_COMBINED
+			&& groups[end]->getOrders() == orders
+			&& groups[end]->getWhere().length() > 0
+			&& !fromPermutation(end)) {
+		++end;
+	}
+	return end;
+}
+
+/**
+ * Read the groups from first to end - 1 with one query, which scans the
+ * headers once. Each row gets a bit in groupmask for every group that
+ * selects it, and the rows of each group are then written in the order of
+ * the query. All rows of the query are held in memory.
+ */
+void spdbread::readCombined(SPDB& db, int first, int end, int batch) {
+	SPVerbose::show(SPVerbose::ESSENTIAL,
+			"Reading data from database for groups #", first, " to #",
+			end - 1);
+	stringstream mask;
+	stringstream where;
+	for (int j = first; j < end; ++j) {
+		SPGroup* group = select->getGroups()[j];
+		group->prepare(db, j);
+		string w = group->getWhere();
+		mask << (j > first ? " + " : "") << (1 << (j - first))
+				<< " * coalesce((" << w << "), 0)";
+		where << (j > first ? " OR " : "") << "(" << w << ")";
+	}
+	string fields = getFields(select->getGroups() + first, end - first)
+			+ mask.str() + " as groupmask, ";
+
+	SPTable result;
+	openQuery(db, select->getGroups()[first], result, fields, where.str());
+	int count = result.fetchRows(-1);
+	int k = background[0] != 0 ? nextQueryGroup(end - 1) : -1;
+	if (k > 0 && combinedEnd(k) == k + 1) {
+		startPrefetch(k, batch);
+	}
+
+	SPAbstractPicker* groupmask = result.getColumnPicker("groupmask");
+	int column = result.getColumnIndex("groupmask");
+	unsigned int max = batch > 0 ? batch : count + 1;
+	vector<unsigned int> rows;
+	for (int j = first; j < end; ++j) {
+		table.clean();
+		long long n = 0;
+		if (estimator != 0) {
+			estimator->reset();
+		}
+		SPCopyMachine* copy = 0;
+		int bit = 1 << (j - first);
+		for (int i = 0; i <= count; ++i) {
+			if (i < count && (groupmask->getInt(result.getArea(i, column))
+					& bit)) {
+				rows.push_back(i);
+			}
+			if (rows.size() == max || (i == count && !rows.empty())) {
+				table.copyRows(result, rows);
+				rows.clear();
+				if (copy == 0) {
+					copy = buildCopyMachine();
+				}
+				if (mapped && n == 0) {
+					adviseAccess();
+				}
+				n += table.numberOfRows();
+				writeRows(copy);
+			}
+		}
+		delete copy;
+		SPVerbose::show(SPVerbose::ESSENTIAL, "End of group #", j,
+				", number of records written: ", n);
+		if (estimator != 0) {
+			estimator->report(cerr, j);
+		}
+	}
+}
+
+/**
+ * Open the query of group j in the background and read its first batch
+ * into next.
+ */
+void spdbread::startPrefetch(int j, int batch) {
+	if (prefetch != 0) {
+		return;
+	}
+	SPVerbose::show(SPVerbose::ESSENTIAL,
+			"Reading data from database in the background for group #", j);
+	next.clean();
+	prefetched = j;
+	prefetchError = "";
+	nextDB = tableDB == background[0] ? background[1] : background[0];
+	prefetch = new thread(&spdbread::prefetchGroup, this, j, batch);
+}
+
+void spdbread::prefetchGroup(int j, int batch) {
+	try {
+		SPDB& db = *nextDB;
+		select->getGroups()[j]->prepare(db, j);
+		openQuery(db, select->getGroups()[j], next);
+		next.fetchRows(batch);
+	} catch (SPException e) {
+		prefetchError = e.what();
+	} catch (...) {
+		prefetchError = "Unexpected exception reading group in background";
+	}
+}
+
+/**
+ * Continue with the query of group j opened in the background, if there is
+ * one. The table then holds its first batch of rows. A query for another
+ * group is waited for and dropped.
+ */
+bool spdbread::takePrefetched(int j) {
+	if (prefetch == 0) {
+		return false;
+	}
+	prefetch->join();
+	delete prefetch;
+	prefetch = 0;
+	if (prefetchError != "") {
+		throw SPException(prefetchError);
+	}
+	if (prefetched != j) {
+		next.clean();
+		return false;
+	}
+	table.swap(next);
+	tableDB = nextDB;
+	return true;
+}
+
+void spdbread::showPlan(SPDB& db, const string& sql) {
+	vector<string> plan = db.explain(sql);
+	cerr << "Query plan for: " << sql << endl;
+	for (unsigned int i = 0; i < plan.size(); ++i) {
+		cerr << "    " << plan[i] << endl;
+	}
+}
+
+/**
+ * Whether the plan of the query reads the whole table without an index or
+ * sorts in a temporary B-tree.
+ */
+bool spdbread::needsIndex(SPDB& db, const string& sql) {
+	vector<string> plan = db.explain(sql);
+	for (unsigned int i = 0; i < plan.size(); ++i) {
+		if (plan[i].find("TEMP B-TREE") != string::npos
+				|| (plan[i].compare(0, 4, "SCAN") == 0
+						&& plan[i].find("INDEX") == string::npos)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * The index for the group: its sort columns in sort order and direction,
+ * then the columns it only selects by.
+ */
+string spdbread::getIndexColumns(SPGroup* group) {
+	stringstream ss;
 	set<string> names;
-	static stringstream ss;
+	string sep = "";
+	for (int pass = 0; pass < 2; ++pass) {
+		for (int i = 0; i < group->getLength(); ++i) {
+			SPColumnSpec* c = group->getColumns()[i];
+			if ((c->getSort() == ' ') != (pass == 1)) {
+				continue;
+			}
+			if ((pass == 1 && c->getSelection() == 0)
+					|| !names.insert(c->getName()).second) {
+				continue;
+			}
+			ss << sep << c->getName() << (c->getSort() == '-' ? " DESC" : "");
+			sep = ", ";
+		}
+	}
+	return ss.str();
+}
+
+/**
+ * Add the values in the files of spec (column:path, separated by ',') to
+ * each group of the selection as a further condition on the column. The
+ * values, or ranges in the syntax of select, are separated by white space
+ * or ','; lines starting with '#' are ignored.
+ */
+string spdbread::addSelectFiles(const string& selection, const string& spec) {
+	stringstream conditions;
+	stringstream ss(spec);
+	string entry;
+	while (getline(ss, entry, ',')) {
+		size_t c = entry.find(':');
+		if (c == string::npos) {
+			throw SPException("No column in selectfile entry: ", entry);
+		}
+		string path = entry.substr(c + 1);
+		ifstream in(path.c_str());
+		if (!in.is_open()) {
+			throw SPException("Selection file open failed: ", path);
+		}
+		conditions << "|" << entry.substr(0, c) << "(";
+		string line;
+		int n = 0;
+		while (getline(in, line)) {
+			if (line.length() > 0 && line[0] == '#') {
+				continue;
+			}
+			for (unsigned int i = 0; i < line.length(); ++i) {
+				if (line[i] == ',' || isspace(line[i])) {
+					line[i] = ' ';
+				}
+			}
+			stringstream values(line);
+			string v;
+			while (values >> v) {
+				conditions << (n++ > 0 ? "," : "") << v;
+			}
+		}
+		conditions << ")";
+		if (n == 0) {
+			// col() would select every trace
+			throw SPException("No values in selection file: ", path);
+		}
+		SPVerbose::show(SPVerbose::ESSENTIAL, "Selecting ", n, " entries from ",
+				path);
+	}
+
+	string c = conditions.str();
+	if (selection.length() == 0) {
+		return c.substr(1);
+	}
+	string res;
+	stringstream groups(selection);
+	string group;
+	while (getline(groups, group, '/')) {
+		res += (res.length() > 0 ? "/" : "") + group + c;
+	}
+	return res;
+}
+
+/**
+ * The sort order of the permutation file the group could be read from: it
+ * sorts by all its columns, selects only by the leading one, and with
+ * values or plain ranges. False if there is no such order.
+ */
+bool spdbread::getPermutationOrder(SPGroup* group, vector<SPSortKey>& order) {
+	if (fileSpec->getLength() != 1 || !getBooleanParameter("perm", true)
+			|| (overrides != 0 && overrides->getLength() > 0)) {
+		return false;
+	}
+	for (int i = 0; i < group->getLength(); ++i) {
+		SPColumnSpec* c = group->getColumns()[i];
+		if (c->getSort() == ' ' || (i > 0 && c->getSelection() != 0)) {
+			return false;
+		}
+		SPSortKey k = { c->getName(), c->getSort() == '-' };
+		order.push_back(k);
+	}
+	SPValueSelection* v = order.empty() ? 0
+			: group->getColumns()[0]->getSelection();
+	for (int i = 0; v != 0 && i < v->getLength(); ++i) {
+		SPRangeSpec* r = v->getRanges()[i];
+		if (r->hasLimits() && r->getMultiple() > 1) {
+			return false;
+		}
+	}
+	return !order.empty();
+}
 
-	ss.str("");
+/**
+ * Write the traces of the group in the order of the permutation file of the
+ * database for the sort order of the group, if there is one and the group
+ * only selects values or ranges of its leading column. n is the number of
+ * traces written.
+ */
+bool spdbread::readPermutation(SPGroup* group, int batch, long long& n) {
+	vector<SPSortKey> order;
+	if (!getPermutationOrder(group, order)) {
+		return false;
+	}
+	vector<pair<int, int> > ranges;
+	SPValueSelection* v = group->getColumns()[0]->getSelection();
+	for (int i = 0; v != 0 && i < v->getLength(); ++i) {
+		SPRangeSpec* r = v->getRanges()[i];
+		if (!r->hasLimits()) {
+			ranges.push_back(make_pair(r->getValue(), r->getValue()));
+		} else if (r->getLowerLimit() <= r->getUpperLimit()) {
+			ranges.push_back(make_pair(r->getLowerLimit(), r->getUpperLimit()));
+		}
+	}
+
+	SPPermutation perm;
+	if (!perm.read(fileSpec->getFiles()[0]->getDBFileName(), order)) {
+		return false;
+	}
 
+	// the rows of each merged range, in the order of the permutation
+	vector<pair<int, int> > slices;
+	if (v == 0) {
+		slices.push_back(make_pair(0, perm.size()));
+	} else {
+		sort(ranges.begin(), ranges.end());
+		vector<pair<int, int> > merged;
+		for (unsigned int i = 0; i < ranges.size(); ++i) {
+			if (!merged.empty() && (long long)ranges[i].first
+					<= merged.back().second + 1LL) {
+				merged.back().second = max(merged.back().second,
+						ranges[i].second);
+			} else {
+				merged.push_back(ranges[i]);
+			}
+		}
+		if (order[0].descending) {
+			reverse(merged.begin(), merged.end());
+		}
+		for (unsigned int i = 0; i < merged.size(); ++i) {
+			int first;
+			int last;
+			perm.getRange(merged[i].first, merged[i].second, first, last);
+			slices.push_back(make_pair(first, last));
+		}
+	}
+
+	SPPicker<int>* indexnumber = table.addColumn<int>("indexnumber");
+	SPPicker<int>* fileid = table.addColumn<int>("fileid");
+	int max = batch > 0 ? batch : perm.size();
+	int file = 0;
+	for (unsigned int s = 0; s < slices.size(); ++s) {
+		for (int i = slices[s].first; i < slices[s].second;) {
+			table.clearRows();
+			for (; i < slices[s].second && table.numberOfRows() < max; ++i) {
+				int r = table.addRow();
+				int index = perm.getIndex(i);
+				indexnumber->set(index, table.getRowStart(r));
+				fileid->set(file, table.getRowStart(r));
+			}
+			if (mapped && n == 0) {
+				adviseAccess();
+			}
+			n += table.numberOfRows();
+			writeRows(0);
+		}
+	}
+	return true;
+}
+
+/**
+ * The sort order of the group, completed by indexnumber and fileid, which
+ * makes it unique.
+ */
+vector<SPSortKey> spdbread::getSortKeys(SPGroup* group) {
+	vector<SPSortKey> order;
 	for (int i = 0; i < group->getLength(); ++i) {
-		names.insert(group->getColumns()[i]->getName());
+		SPColumnSpec* c = group->getColumns()[i];
+		if (c->getSort() != ' ') {
+			SPSortKey k = { c->getName(), c->getSort() == '-' };
+			order.push_back(k);
+		}
+	}
+	SPSortKey k = { "indexnumber", false };
+	order.push_back(k);
+	k.column = "fileid";
+	order.push_back(k);
+	return order;
+}
+
+/**
+ * The columns the queries of the groups need besides indexnumber and fileid,
+ * each followed by ", ".
+ */
+string spdbread::getFields(SPGroup** groups, int count) {
+	set<string> names;
+	stringstream ss;
+
+	for (int j = 0; j < count; ++j) {
+		for (int i = 0; i < groups[j]->getLength(); ++i) {
+			names.insert(groups[j]->getColumns()[i]->getName());
+		}
 	}
 	if (overrides != 0) {
 		for (int i = 0; i < overrides->getLength(); ++i) {
@@ -370,19 +918,74 @@ stringstream& spdbread::getSQL(SPDB& db, SPGroup *group) {
 	for (set<string>::iterator i = names.begin(); i != names.end(); i++) {
 		ss << *i << ", ";
 	}
+	return ss.str();
+}
+
+/**
+ * Restrict the samples read to tmin to tmax, every jsamp-th sample, if any
+ * of them is given. The times are in seconds like for suwind, the sample
+ * times are taken from the first trace. Returns whether there is a window.
+ * A dry run reads no trace data and takes the delay of the traces as 0.
+ */
+bool spdbread::setSampleWindow() {
+	if (headerMode != TRACES || !(hasParameter("tmin")
+			|| hasParameter("tmax") || hasParameter("jsamp"))) {
+		return false;
+	}
+	int ns = files[0]->getNumberOfSamples();
+	double dt = files[0]->getSampleInterval() / 1000000.0;
+	double t0 = getBooleanParameter("dryrun", false) ? 0
+			: files[0]->readDelay() / 1000.0;
+	double tmin = getDoubleParameter("tmin", t0);
+	double tmax = getDoubleParameter("tmax", t0 + (ns - 1) * dt);
+	int step = getIntParameter("jsamp", 1);
+
+	int first = lround((tmin - t0) / dt);
+	int last = lround((tmax - t0) / dt);
+	if (first < 0) {
+		first = 0;
+	}
+	if (last > ns - 1) {
+		last = ns - 1;
+	}
+	if (last < first || step < 1) {
+		throw SPException("Empty sample window, check tmin, tmax and jsamp");
+	}
+	int count = (last - first) / step + 1;
+	SPVerbose::show(SPVerbose::ESSENTIAL, "Sample window from sample ", first,
+			" to ", last);
+	for (int i = 0; i < fileSpec->getLength(); ++i) {
+		// the dt of the traces is multiplied by the step, an unsigned short
+		if ((long)files[i]->getSampleInterval() * step > 65535) {
+			throw SPException("Sample interval too large for jsamp=", step,
+					" in ", files[i]->getDataPath());
+		}
+		files[i]->setWindow(first, count, step);
+	}
+	return true;
+}
 
-	string table = db.getUnionTable("headers", ss.str(), group->getWhere(),
-			"fileid");
+/**
+ * The query of the group, built anew on each call as the thread of
+ * overlap=1 opens queries too.
+ */
+string spdbread::getSQL(SPDB& db, SPGroup *group, const string& fields,
+		const string& where, bool sorted) {
+	stringstream ss;
 
-	ss.str("");
+	string table = db.getUnionTable("headers", fields, where, "fileid");
 
+	if (!sorted) {
+		ss << table << ";";
+		return ss.str();
+	}
 	if (db.getNumberOfFiles() == 1) {
 		ss << table;
 	} else {
 		ss << "select * from (" << table << ")";
 	}
 	ss << " order by " << group->getOrders() << " indexnumber;";
-	return ss;
+	return ss.str();
 }
 
 /// This is the normal code for the program driver.
@@ -427,6 +1030,148 @@ const char
 				"                 =0 IEEE floating point.",
 				"                 This parameter is ignored if data file is in SU format",
 				"",
+				"      mmap=0     or 1 to memory map the data files instead of reading",
+				"                 each trace with a system call. Traces that need no",
+				"                 byte swap or format conversion are then written to",
+				"                 the output straight from the mapped pages.",
+				"",
+				"      window=128 number of traces read ahead of the output. The",
+				"                 traces in the window are read in the order of their",
+				"                 position in the data files and put back into the",
+				"                 selected order before output. Larger windows save",
+				"                 more seeks when the sort order differs from the file",
+				"                 order, at the cost of one trace buffer per trace.",
+				"",
+				"      gap=2      traces in the window that are at most this number of",
+				"                 traces apart in a data file are read with one single",
+				"                 read, the traces in between are skipped. =-1 reads",
+				"                 every trace separately. Not used with mmap=1.",
+				"",
+				"      maxblock=4096 upper limit in KB for one such joined read.",
+				"",
+				"      depth=4    number of reads kept in flight ahead of the output.",
+				"                 =0 reads synchronously. Not used with mmap=1.",
+				"",
+				"      uring=1    use io_uring for the reads in flight if the kernel",
+				"                 supports it, =0 or no support uses a pool of depth",
+				"                 reader threads instead.",
+				"",
+				"      merge=1    with several database files query each file in the",
+				"                 sort order on its own and merge the results, =0",
+				"                 sorts all rows in one query instead.",
+				"",
+				"      combine=1  read consecutive groups that sort in the same",
+				"                 order with one single query, which tags each row",
+				"                 with the groups it belongs to, and split the rows",
+				"                 up by group. The headers are then scanned once",
+				"                 instead of once per group, at the cost of holding",
+				"                 all selected rows of these groups in memory. Up to",
+				"                 30 groups go into one query. A group without a",
+				"                 selection, which reads all traces, is read on its",
+				"                 own in batches. Not used with memsort=1 or",
+				"                 autoindex=1.",
+				"",
+				"      overlap=1  with several groups run the query of the next group",
+				"                 and read its first batch of rows on a database",
+				"                 connection of its own while the traces of the",
+				"                 current group are written. =0 queries each group",
+				"                 only when the previous one is done. Not used with",
+				"                 memsort=1 or autoindex=1.",
+				"",
+				"      selectfile=column:path select traces by the values of the",
+				"                 column listed in the file, in addition to select=.",
+				"                 The values, or ranges like in select=, are",
+				"                 separated by blanks, commas or new lines, lines",
+				"                 starting with # are skipped. Several files are",
+				"                 separated by commas, e.g. fldr:shots.txt,gx:rcv.txt",
+				"",
+				"      valuetable=1000 a column selected by more values than this",
+				"                 is selected through a temporary table of the",
+				"                 values instead of a list in the query.",
+				"",
+				"      inlist=256 ranges with increment, e.g. cdp(500:900:4), of up to",
+				"                 this number of values are selected by a list of",
+				"                 the values, which an index can be searched for.",
+				"                 Larger ones are selected by the range and a",
+				"                 filter on the increment.",
+				"",
+				"      memsort=0  or 1 to read the rows of each group unsorted and",
+				"                 sort them in memory with a radix sort, which is",
+				"                 much faster than the sort of SQLite for large",
+				"                 selections. All rows of a group are held in",
+				"                 memory at once, batch= does not apply. The sort",
+				"                 columns must be integer columns.",
+				"",
+				"      sortthreads= number of threads for memsort=1, defaults to",
+				"                 the number of processors.",
+				"",
+				"      perm=1     read the traces of a group in the order of the",
+				"                 permutation file written by spdbperm for the sort",
+				"                 order of the group, instead of querying the",
+				"                 database, if there is one database file, no",
+				"                 overrides, and the group selects at most values",
+				"                 or ranges without increment of its first column.",
+				"",
+				"      headeronly=0 or 1 to write the traces without samples, ns=0,",
+				"                 with the headers stored in the databases by",
+				"                 spdbwrite traceheaders=1. The data files are not",
+				"                 read. Overrides are applied.",
+				"",
+				"      zerosamples=0 or 1 like headeronly=1, but the traces have",
+				"                 their ns samples, all zero.",
+				"",
+				"      tmin=      first time in seconds of the samples to output,",
+				"                 defaults to the first sample.",
+				"",
+				"      tmax=      last time in seconds of the samples to output,",
+				"                 defaults to the last sample.",
+				"",
+				"      jsamp=1    output every jsamp-th sample only.",
+				"                 With any of tmin, tmax and jsamp only the samples",
+				"                 up to tmax are read from the data files, and ns,",
+				"                 dt and delrt of the output are set for the",
+				"                 samples written. The times of the samples are",
+				"                 taken from the first trace, and gap= defaults",
+				"                 to -1.",
+				"",
+				"      dryrun=0   or 1 to only report for each group what reading it",
+				"                 would cost: traces, bytes, seeks and seek distance",
+				"                 in the order the traces are requested, and the part",
+				"                 of each data file touched. No traces are read or",
+				"                 written. The read window reduces the actual seeks.",
+				"                 The bytes are those of the sample window, whose",
+				"                 tmin and tmax assume traces without delay.",
+				"",
+				"      explain=0  or 1 to log the SQLite query plan of each group.",
+				"",
+				"      autoindex=0 or 1 to create an index on the sort and selection",
+				"                 columns of a group in each database file whose",
+				"                 query plan scans the whole table or sorts in a",
+				"                 temporary B-tree. The index stays in the file, so",
+				"                 the next read with the same order uses it. The",
+				"                 database files must be writable.",
+				"",
+				"      perdevice=1 keep a queue of depth reads per disk or mount",
+				"                 point the data files are on, so files on different",
+				"                 disks are read in parallel. =0 uses one queue.",
+				"",
+				"      cache=0    size in MB of a cache of decoded traces, for",
+				"                 selections whose groups share traces. The traces",
+				"                 in the cache are not read again. The numbers of",
+				"                 cache hits and misses are printed at the end.",
+				"",
+				"      outbuffer=1024 size in KB of each of the four output buffers.",
+				"                 The traces are written when all buffers are full.",
+				"                 =0 writes each trace with fputtr.",
+				"",
+				"      vmsplice=0 or 1 to splice the output buffers into stdout",
+				"                 instead of copying them, if stdout is a pipe.",
+				"",
+				"      batch=65536 number of selected rows taken from the database",
+				"                 at a time. Output starts after the first batch and",
+				"                 the memory use does not grow with the size of the",
+				"                 selection. =0 reads the whole selection first.",
+				"",
 				" Path specification syntax:",
 				"",
 				"      The paths to both the data set files and the index files are as",
@@ -0,0 +1,218 @@
+//============================================================================
+// Name        : SPHeaderScanner.cpp
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+
+#define _FILE_OFFSET_BITS 64
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <su.h>
+#include <segy.h>
+#include <header.h>
+#include "SPHeaderScanner.hh"
+#include <SPConvert.hh>
+
+using namespace std;
+using namespace SP;
+
+#undef open
+
+/**
+ * The layout of the file is worked out like in spdbread: an optional tape
+ * and binary header, then records of equal length with the number of
+ * samples of the first trace. swap 0 or 1 overrides whether the numbers
+ * are swapped, by default segy tape data is swapped on little endian machines.
+ */
+SPHeaderScanner::SPHeaderScanner(const string& path, bool segytape,
+		bool fortran, int swap) :
+	path(path), count(0), chunkSize(1), chunks(0), nextChunk(0), consumed(0),
+			current(0), stopping(false) {
+	// the number of samples of the first trace must be read with it already
+	byteswap = swap < 0 ? segytape != bigEndianMachine() : swap != 0;
+	headerOffset = 0;
+	if (fortran) {
+		headerOffset += 4;
+	}
+	if (segytape) {
+		headerOffset += 3600;
+		if (fortran) {
+			headerOffset += 16;
+		}
+	}
+
+	fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw SPException("Data file ", path, " open failed: ", errno);
+	}
+	struct stat res;
+	if (fstat(fd, &res) != 0) {
+		throw SPException("Cannot get stat of file ", path, ": ", errno);
+	}
+
+	char header[HDRBYTES];
+	readFully(header, HDRBYTES, headerOffset);
+	if (byteswap) {
+		SPConvert::swapHeader(header);
+	}
+	int ns = ((segy*)header)->ns;
+	if (ns == 0) {
+		throw SPException("No number of samples in the first trace of ", path);
+	}
+	recordLength = HDRBYTES + ns * 4;
+	if (fortran) {
+		recordLength += 8;
+	}
+	nrTraces = (res.st_size - headerOffset + (fortran ? 4 : 0))
+			/ recordLength;
+	wholeRecords = recordLength < 2 * sysconf(_SC_PAGESIZE);
+
+	SPVerbose::show(SPVerbose::DATA, "Scanning headers of: ", path);
+	SPVerbose::show(SPVerbose::DATA, "byteswap: ", byteswap);
+	SPVerbose::show(SPVerbose::DATA, "recordLength: ", recordLength);
+	SPVerbose::show(SPVerbose::DATA, "nrTraces: ", nrTraces);
+}
+
+SPHeaderScanner::~SPHeaderScanner() {
+	{
+		unique_lock<mutex> l(lock);
+		stopping = true;
+	}
+	slotFree.notify_all();
+	for (unsigned int i = 0; i < workers.size(); ++i) {
+		workers[i].join();
+	}
+	close(fd);
+}
+
+/**
+ * Start reading the headers of the first count traces, all if count < 1,
+ * with the number of threads.
+ */
+void SPHeaderScanner::start(int threads, int count) {
+	if (threads < 1) {
+		threads = 1;
+	}
+	this->count = count < 1 || count > nrTraces ? nrTraces : count;
+	// large enough chunks to keep the reads long, at least one per thread
+	chunkSize = (1 << 20) / recordLength;
+	if (chunkSize < 16) {
+		chunkSize = 16;
+	}
+	chunks = (this->count + chunkSize - 1) / chunkSize;
+	slots.resize(2 * threads, vector<char>(chunkSize * HDRBYTES));
+	ready.resize(slots.size(), -1);
+	SPVerbose::show(SPVerbose::DATA, "Scanning threads: ", threads,
+			", traces per chunk: ", chunkSize);
+	for (int i = 0; i < threads; ++i) {
+		workers.push_back(thread(&SPHeaderScanner::work, this));
+	}
+}
+
+/**
+ * The header of the next trace in native byte order, 0 after the last one.
+ * It stays valid until the next call.
+ */
+char* SPHeaderScanner::next() {
+	if (current >= count) {
+		return 0;
+	}
+	int chunk = current / chunkSize;
+	int s = chunk % slots.size();
+	if (current % chunkSize == 0) {
+		unique_lock<mutex> l(lock);
+		if (chunk > 0) {
+			// the slot of the previous chunk can take the next one
+			consumed = chunk;
+			slotFree.notify_all();
+		}
+		while (ready[s] != chunk && error.empty()) {
+			chunkReady.wait(l);
+		}
+		if (!error.empty()) {
+			throw SPException(error);
+		}
+	}
+	return &slots[s][(current++ % chunkSize) * HDRBYTES];
+}
+
+void SPHeaderScanner::work() {
+	vector<char> buffer;
+	for (;;) {
+		int chunk;
+		{
+			unique_lock<mutex> l(lock);
+			if (nextChunk >= chunks) {
+				return;
+			}
+			chunk = nextChunk++;
+			while (chunk >= consumed + (int)slots.size() && !stopping) {
+				slotFree.wait(l);
+			}
+			if (stopping) {
+				return;
+			}
+		}
+		int s = chunk % slots.size();
+		try {
+			readChunk(chunk, &slots[s][0], buffer);
+		} catch (SPException e) {
+			unique_lock<mutex> l(lock);
+			error = e.what();
+			chunkReady.notify_all();
+			return;
+		}
+		{
+			unique_lock<mutex> l(lock);
+			ready[s] = chunk;
+		}
+		chunkReady.notify_all();
+	}
+}
+
+/**
+ * Read the headers of the traces of the chunk into headers and convert
+ * them to native byte order.
+ */
+void SPHeaderScanner::readChunk(int chunk, char* headers,
+		vector<char>& buffer) {
+	int first = chunk * chunkSize;
+	int n = count - first < chunkSize ? count - first : chunkSize;
+	if (wholeRecords) {
+		long long length = ((long long)n - 1) * recordLength + HDRBYTES;
+		buffer.resize(length);
+		readFully(&buffer[0], length, getPosition(first));
+		for (int i = 0; i < n; ++i) {
+			memcpy(headers + i * HDRBYTES, &buffer[((long)i) * recordLength],
+					HDRBYTES);
+		}
+	} else {
+		for (int i = 0; i < n; ++i) {
+			readFully(headers + i * HDRBYTES, HDRBYTES, getPosition(first + i));
+		}
+	}
+	if (byteswap) {
+		for (int i = 0; i < n; ++i) {
+			SPConvert::swapHeader(headers + i * HDRBYTES);
+		}
+	}
+}
+
+void SPHeaderScanner::readFully(char* buffer, long long length,
+		long long offset) {
+	while (length > 0) {
+		ssize_t done = pread(fd, buffer, length, offset);
+		if (done <= 0) {
+			throw SPException("Reading headers from ", path, " failed at ",
+					offset);
+		}
+		buffer += done;
+		offset += done;
+		length -= done;
+	}
+}
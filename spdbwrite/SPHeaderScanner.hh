@@ -0,0 +1,83 @@
+//============================================================================
+// Name        : SPHeaderScanner.hh
+// Author      : Sanyu Ye,  SoftSeis,  Norway
+// Version     : 1.1, Sept. 2020
+// Copyright   : SoftSeis, Norway, all rights reserved
+//============================================================================
+#ifndef SPHEADERSCANNER_HH_
+#define SPHEADERSCANNER_HH_
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <SPBaseUtil.hh>
+
+using namespace std;
+
+namespace SP {
+
+/**
+ * Reads the trace headers of an SU or SEGY file directly, without the
+ * samples. The traces are split into chunks, which a pool of threads reads
+ * and converts to native byte order in parallel, while ::next hands out the
+ * headers in file order. With records of several pages only the headers are
+ * read, otherwise whole chunks of records with one read each.
+ */
+class SPHeaderScanner {
+public:
+	SPHeaderScanner(const string& path, bool segytape, bool fortran,
+			int swap = -1);
+	~SPHeaderScanner();
+
+	int getNumberOfTraces() {
+		return nrTraces;
+	}
+
+	void start(int threads, int count);
+	char* next();
+
+private:
+	void work();
+	void readChunk(int chunk, char* headers, vector<char>& buffer);
+	void readFully(char* buffer, long long length, long long offset);
+
+	long long getPosition(int id) {
+		return ((long long)recordLength) * id + headerOffset;
+	}
+
+private:
+	string path;
+	int fd;
+	bool byteswap;
+	int recordLength;
+	long long headerOffset;
+	int nrTraces;
+	/** read the records as a whole rather than the headers only */
+	bool wholeRecords;
+
+	/** the traces to scan, in chunks of chunkSize traces */
+	int count;
+	int chunkSize;
+	int chunks;
+
+	/** the chunks go round through the slots, ::next reads them in order */
+	vector<vector<char> > slots;
+	/** the chunk in each slot once it is read, -1 before */
+	vector<int> ready;
+	/** the next chunk for a worker, and the first chunk not yet consumed */
+	int nextChunk;
+	int consumed;
+	/** the trace ::next delivers next */
+	int current;
+
+	vector<thread> workers;
+	mutex lock;
+	condition_variable slotFree;
+	condition_variable chunkReady;
+	bool stopping;
+	string error;
+};
+}
+#endif /*SPHEADERSCANNER_HH_*/
@@ -10,11 +10,15 @@
 #include <iostream>
 #include <fstream>
 #include <set>
+#include <sstream>
 #include <stdlib.h>
 #include <errno.h>
 #include <SPProcessor.hh>
 #include <SPAccessors.hh>
+#include <header.h>
 #include <SPTable.hh>
+#include <SPTableWriter.hh>
+#include "SPHeaderScanner.hh"
 #include <string>
 #include <sqlite3.h>
 #include <ctime>
@@ -25,6 +29,79 @@
 using namespace std;
 using namespace SP;
 
+/**
+ * Writes the headers table and, if asked for, the complete trace headers of
+ * each batch into table traceheaders, which spdbread can serve header only
+ * reads from.
+ */
+class SPHeaderWriter : public SPTableWriter {
+public:
+	SPHeaderWriter(SPTable& prototype, const string& dbPath, int batchRows,
+			int depth, bool traceHeaders) :
+		SPTableWriter(prototype, dbPath, "headers", batchRows, depth),
+				headerInsert(0) {
+		if (traceHeaders) {
+			headers.resize(getDepth() * (long)getBatchRows() * HDRBYTES);
+		}
+	}
+
+	~SPHeaderWriter() {
+		if (headerInsert != 0) {
+			sqlite3_finalize(headerInsert);
+		}
+	}
+
+	/**
+	 * Where the complete header of the row of the batch goes, only with
+	 * trace headers.
+	 */
+	char* getHeader(int slot, int row) {
+		return &headers[((long)slot * getBatchRows() + row) * HDRBYTES];
+	}
+
+	bool hasHeaders() {
+		return !headers.empty();
+	}
+
+protected:
+	void prepare(SPDB& db);
+	void writeBatch(SPDB& db, int slot);
+
+private:
+	vector<char> headers;
+	sqlite3_stmt* headerInsert;
+};
+
+void SPHeaderWriter::prepare(SPDB& db) {
+	if (headers.empty()) {
+		return;
+	}
+	stringstream ss;
+	ss << "create table traceheaders (indexnumber integer, header blob, "
+			<< "primary key (indexnumber));";
+	db.executeStatement(ss, "create trace header table");
+	ss.str("");
+	ss << "insert into traceheaders values (?, ?);";
+	headerInsert = db.prepareStatement(ss, "trace header inserts");
+}
+
+void SPHeaderWriter::writeBatch(SPDB&, int slot) {
+	if (headerInsert == 0) {
+		return;
+	}
+	SPTable& rows = getRows(slot);
+	for (int r = 0; r < rows.numberOfRows(); ++r) {
+		sqlite3_bind_int(headerInsert, 1, rows.get<int>("indexnumber", r));
+		sqlite3_bind_blob(headerInsert, 2, getHeader(slot, r), HDRBYTES,
+				SQLITE_STATIC);
+		int rc = sqlite3_step(headerInsert);
+		if (rc != SQLITE_DONE) {
+			throw SPException("trace header insertion failed: ", rc);
+		}
+		sqlite3_reset(headerInsert);
+	}
+}
+
 class spdbwrite : public SPProcessor {
 public:
 	const static string defaultFields[];
@@ -34,12 +111,31 @@ public:
 	void process(SPSegy* data);
 	void cleanup();
 
+private:
+	void parseIndexes(const string& spec, set<string>& fields);
+	void createIndexes(SPDB& db);
+	void addHeader(segy* trace);
+	void scanData();
+
 private:
 
+	/** the columns of the headers table, the rows go to the writer */
 	SPTable table;
 	SPCopyMachine copy;
 	SPPicker<int>* id;
 	string dbpath;
+	/** the file the database is built in, renamed to dbpath when complete */
+	string building;
+
+	/** number of traces read */
+	int traces;
+	SPHeaderWriter* writer;
+	/** the batch being filled, -1 if none */
+	int slot;
+	/** the database is built in memory and saved at the end */
+	bool memory;
+	/** for scan=1, the headers come from the data file */
+	SPHeaderScanner* scanner;
 
 	int dt; // sampling rate for all traces in the data set all traces must have identical values 
 	int ns; // size of all traces in the data set all traces must have identical values
@@ -47,6 +143,9 @@ private:
 	int scalco; // scale used for coordinate values
 
 	int max;
+
+	/** column lists of the indexes to create, as in SQL */
+	vector<string> indexes;
 };
 
 const string spdbwrite::defaultFields[] = { "fldr", "tracf", "ep", "cdp",
@@ -92,6 +191,10 @@ void spdbwrite::init() {
 		throw SPException("The file ", dbpath, " already exists, shutting down");
 	}
 	f.close();
+	// a failed run leaves only the temporary file, which the next one drops
+	building = dbpath + ".tmp";
+	remove(building.c_str());
+	remove((building + "-journal").c_str());
 
 	set<string> fields;
 
@@ -115,6 +218,12 @@ void spdbwrite::init() {
 		}
 	}
 
+	if (hasParameter("indexes")) {
+		string s = getStringParameter("indexes");
+		SPVerbose::show(SPVerbose::ESSENTIAL, "Parameter found: indexes=", s);
+		parseIndexes(s, fields);
+	}
+
 	SPVerbose::show(SPVerbose::ESSENTIAL,
 			"Preparing columns in the headers table");
 	id = table.addColumn<int>("indexnumber");
@@ -129,15 +238,61 @@ void spdbwrite::init() {
 		SPVerbose::show(SPVerbose::DATA, *i);
 	}
 
+	bool traceHeaders = getBooleanParameter("traceheaders", false);
+	if (traceHeaders) {
+		SPVerbose::show(SPVerbose::ESSENTIAL,
+				"Storing the trace headers in table traceheaders");
+	}
+	table.setPrimaryKey("indexnumber");
+	traces = 0;
+	slot = -1;
+	scanner = 0;
+	if (getBooleanParameter("scan", false)) {
+		// opened first, so a missing data file leaves no database behind
+		string path = getStringParameter("datapath", "data.su");
+		int byteswap = hasParameter("byteswap")
+				? getBooleanParameter("byteswap", false) : -1;
+		scanner = new SPHeaderScanner(path, getBooleanParameter("segytape",
+				false), getBooleanParameter("fortran", false), byteswap);
+	}
+	memory = getBooleanParameter("memory", false);
+	writer = new SPHeaderWriter(table, memory ? ":memory:" : building,
+			getIntParameter("batch", 65536), getIntParameter("queue", 4),
+			traceHeaders);
+	if (memory || getBooleanParameter("bulk", false)) {
+		SPVerbose::show(SPVerbose::ESSENTIAL, "Bulk loading the database",
+				memory ? " in memory" : "");
+		writer->getDB().setBulkLoad(getIntParameter("cache", 256),
+				getIntParameter("pagesize", 65536));
+	}
+	writer->start();
+
+	if (scanner != 0) {
+		scanData();
+		stop();
+		return;
+	}
 	SPVerbose::show(SPVerbose::ESSENTIAL, "Start reading traces from input");
 }
 
 void spdbwrite::process(SPSegy* data) {
-	if (table.numberOfRows() == 0) {
-		dt = data->get<unsigned short>("dt");
-		ns =data->get<unsigned short>("ns");
-		scalel =data->get<short>("scalel");
-		scalco =data->get<short>("scalco");
+	addHeader(data->getTrace());
+	dispatch(data);
+
+	if (max > 0 && traces >= max) {
+		stop();
+	}
+}
+
+/**
+ * Add the row for the header of the next trace.
+ */
+void spdbwrite::addHeader(segy* trace) {
+	if (traces == 0) {
+		dt = trace->dt;
+		ns = trace->ns;
+		scalel = trace->scalel;
+		scalco = trace->scalco;
 
 		SPVerbose::show(SPVerbose::ESSENTIAL, "Trace matric data dt: ", dt);
 		SPVerbose::show(SPVerbose::ESSENTIAL, "Trace matric data ns: ", ns);
@@ -146,25 +301,56 @@ void spdbwrite::process(SPSegy* data) {
 		SPVerbose::show(SPVerbose::ESSENTIAL, "Trace matric data scalco: ",
 				scalco);
 
-	} else if (dt !=data->get<unsigned short>("dt") || ns
-			!=data->get<unsigned short>("ns") || scalel
-			!=data->get<short>("scalel") || scalco !=data->get<short>("scalco")) {
+	} else if (dt != trace->dt || ns != trace->ns || scalel != trace->scalel
+			|| scalco != trace->scalco) {
 		throw SPException("Inconsistent data detected");
 	}
 
-	int i = table.addRow();
-	id->set(i, table.getRowStart(i));
-	copy.run(data->getTrace(), table.getRowStart(i));
-	dispatch(data);
+	if (slot < 0) {
+		slot = writer->acquire();
+	}
+	// the pickers of table work on the rows of the batches
+	SPTable& rows = writer->getRows(slot);
+	int r = rows.addRow();
+	id->set(traces, rows.getRowStart(r));
+	copy.run(trace, rows.getRowStart(r));
+	if (writer->hasHeaders()) {
+		memcpy(writer->getHeader(slot, r), trace, HDRBYTES);
+	}
+	++traces;
+	if (rows.numberOfRows() == writer->getBatchRows()) {
+		writer->submit(slot);
+		slot = -1;
+	}
+}
 
-	if (max > 0 && table.numberOfRows() >= max) {
-		stop();
+/**
+ * Read the headers straight from the data file instead of the input stream,
+ * no samples are read and nothing is written to the output.
+ */
+void spdbwrite::scanData() {
+	SPVerbose::show(SPVerbose::ESSENTIAL, "Scanning trace headers in ",
+			getStringParameter("datapath", "data.su"));
+	scanner->start(getIntParameter("scanthreads", 4), max);
+	while (char* header = scanner->next()) {
+		addHeader((segy*)header);
 	}
+	delete scanner;
+	scanner = 0;
 }
 
 void spdbwrite::cleanup() {
 	SPVerbose::show(SPVerbose::ESSENTIAL, "Input file end");
 
+	if (slot >= 0) {
+		writer->submit(slot);
+		slot = -1;
+	}
+	SPVerbose::show(SPVerbose::ESSENTIAL,
+			"Waiting for the header data to be written");
+	writer->finish();
+	SPDB& db = writer->getDB();
+
 	map<string, string> meta;
 	meta["datapath"] = getStringParameter("datapath", "data.su");
 	meta["comment"] = getStringParameter("comment", "");
@@ -172,27 +358,80 @@ void spdbwrite::cleanup() {
 			: "false";
 	meta["fortran"] = getBooleanParameter("fortran", false) ? "true" : "false";
 	meta["creationdate"] = getTimeString();
-	meta["creator"] = getenv("USER");
+	const char* user = getenv("USER");
+	meta["creator"] = user == 0 ? "" : user;
 
 	meta["dt"] = cat(dt);
 	meta["ns"] = cat(ns);
 	meta["scalel"] = cat(scalel);
 	meta["scalco"] = cat(scalco);
-	int nr = table.numberOfRows();
-	meta["numberoftraces"] = cat(nr);
+	meta["numberoftraces"] = cat(traces);
 
 	SPVerbose::show(SPVerbose::ESSENTIAL, "Dumping meta data to database");
 	SPKVTable* t = new SPKVTable();
-	t->createTable(dbpath, "meta", meta);
+	t->createTable(db, "meta", meta);
 
 	SPVerbose::show(SPVerbose::ESSENTIAL, "Meta table content");
 	for (map<string, string>::iterator i = meta.begin(); i != meta.end(); i++) {
 		SPVerbose::show(SPVerbose::ESSENTIAL, i->first, ": ", i->second);
 	}
-	
-	SPVerbose::show(SPVerbose::ESSENTIAL, "Dumping header data to database");
-	table.setPrimaryKey("indexnumber");
-	table.createTable(dbpath, "headers");
+
+	// indexes are built only now, on the complete table
+	createIndexes(db);
+	if (memory) {
+		db.saveTo(dbpath);
+	}
+	delete writer;
+	writer = 0;
+	if (!memory && rename(building.c_str(), dbpath.c_str()) != 0) {
+		throw SPException("Renaming database to ", dbpath, " failed: ", errno);
+	}
+}
+
+/**
+ * Indexes are separated by ',' and their columns by ':', a column followed
+ * by '-' is indexed descending, e.g. cdp:offset,fldr:tracf-. All columns
+ * must be in the table.
+ */
+void spdbwrite::parseIndexes(const string& spec, set<string>& fields) {
+	stringstream ss(spec);
+	string index;
+	while (getline(ss, index, ',')) {
+		stringstream is(index);
+		string column;
+		string columns;
+		while (getline(is, column, ':')) {
+			bool descending = column.length() > 0
+					&& column[column.length() - 1] == '-';
+			if (descending) {
+				column.erase(column.length() - 1);
+			}
+			if (column != "indexnumber" && fields.count(column) == 0) {
+				throw SPException("Index column not in the table: ", column);
+			}
+			if (columns.length() > 0) {
+				columns += ", ";
+			}
+			columns += column;
+			if (descending) {
+				columns += " DESC";
+			}
+		}
+		if (columns.length() > 0) {
+			indexes.push_back(columns);
+		}
+	}
+}
+
+void spdbwrite::createIndexes(SPDB& db) {
+	if (indexes.empty()) {
+		return;
+	}
+	for (unsigned int i = 0; i < indexes.size(); ++i) {
+		db.createIndex(0, "headers", indexes[i]);
+	}
+	stringstream ss("analyze;");
+	db.executeStatement(ss, "analyze");
 }
 
 /// This is the normal code for the program driver.
@@ -213,6 +452,8 @@ const char
 				"             indexing the input stream. The file usually has the",
 				"             extension \".db\". The file must be none existent,",
 				"             otherwise this module exits with an error code.",
+				"             The database is built in dbpath.tmp and renamed",
+				"             to dbpath once it is complete.",
 				"",
 				" Optional parameters:",
 				"",
@@ -232,6 +473,35 @@ const char
 				"      fortran=0: or 1 if the data is written by Fortran with leading",
 				"             and trailing delimiters for each record",
 				"      comment= : add comments to this index database.",
+				"      scan=0: or 1 to read the trace headers directly from the",
+				"             file datapath instead of the input stream, which is",
+				"             then neither read nor written. Only the headers are",
+				"             read, with segytape and fortran describing the file.",
+				"      scanthreads=4: number of threads reading headers for scan=1",
+				"      byteswap= : for scan=1, override whether the numbers in the",
+				"             file are swapped, by default segy tape data is",
+				"             swapped on little endian machines",
+				"      indexes= : indexes to create on the headers table after",
+				"             loading, separated by commas, their columns by colons,",
+				"             a column followed by - is indexed descending, e.g.",
+				"             indexes=cdp:offset,fldr:tracf-",
+				"      traceheaders=0: or 1 to store the complete trace headers in",
+				"             table traceheaders as well, for spdbread headeronly=1",
+				"      batch=65536: number of header rows written to the database",
+				"             in one transaction. The rows are written by a thread",
+				"             of its own while further traces are read.",
+				"      queue=4: number of batches that can wait to be written",
+				"             before reading the input waits for the database.",
+				"             The memory used is about batch*queue rows.",
+				"      bulk=0: or 1 to fill the database without journal and",
+				"             without syncing to disk, with a large cache and page",
+				"             size. Much faster, but a crash leaves a corrupt",
+				"             database behind, which must be deleted.",
+				"      memory=0: or 1 to build the database in memory, with the",
+				"             settings of bulk=1, and save it to dbpath at the",
+				"             end. The whole database must fit in memory.",
+				"      cache=256: cache size in MB for bulk=1 and memory=1",
+				"      pagesize=65536: database page size for bulk=1 and memory=1",
 				"",
 				" Notes:",
 				"",
@@ -247,6 +517,9 @@ const char
 				"",
 				" Examples:",
 				"",
+				"    create a database file for existing segy data without a pipe",
+				"        spdbwrite dbpath=seisdata.db datapath=seisdata.sgy \\ ",
+				"        segytape=1 scan=1", "",
 				"    create a database file for existing segy data",
 				"        segyread tape=seisdata.sgy | \\ ",
 				"        spdbwrite dbpath=seisdata.db datapath=seisdata.sgy \\ ",